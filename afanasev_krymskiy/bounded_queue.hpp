@@ -0,0 +1,66 @@
+#pragma once
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace uni_course_cpp {
+// Blocking FIFO of a fixed capacity between pipeline stages: producers wait
+// while it is full, consumers wait while it is empty. Once closed, pop()
+// drains what is left and then returns nothing.
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(std::size_t capacity) : capacity_(capacity) {
+    assert(capacity > 0);
+  }
+  BoundedQueue(const BoundedQueue& other) = delete;
+  void operator=(const BoundedQueue& other) = delete;
+
+  void push(T&& item) {
+    {
+      std::unique_lock lock(mutex_);
+      not_full_condition_.wait(
+          lock, [this]() { return items_.size() < capacity_; });
+      assert(!is_closed_);
+      items_.push_back(std::move(item));
+    }
+    not_empty_condition_.notify_one();
+  }
+
+  std::optional<T> pop() {
+    auto item = std::optional<T>();
+    {
+      std::unique_lock lock(mutex_);
+      not_empty_condition_.wait(
+          lock, [this]() { return !items_.empty() || is_closed_; });
+      if (items_.empty())
+        return std::nullopt;
+      item.emplace(std::move(items_.front()));
+      items_.pop_front();
+    }
+    not_full_condition_.notify_one();
+    return item;
+  }
+
+  // No more items may be pushed, waiting consumers are woken up.
+  void close() {
+    {
+      const std::lock_guard lock(mutex_);
+      is_closed_ = true;
+    }
+    not_empty_condition_.notify_all();
+  }
+
+ private:
+  const std::size_t capacity_;
+  std::deque<T> items_;
+  bool is_closed_ = false;
+  std::mutex mutex_;
+  std::condition_variable not_full_condition_;
+  std::condition_variable not_empty_condition_;
+};
+}  // namespace uni_course_cpp
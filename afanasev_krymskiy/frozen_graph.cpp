@@ -0,0 +1,38 @@
+#include "frozen_graph.hpp"
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include "graph.hpp"
+
+namespace uni_course_cpp {
+FrozenGraph::FrozenGraph(Graph&& graph)
+    : edges_(graph.edges_), stats_(graph.stats_) {
+  const auto vertices_count = graph.vertices_.size();
+
+  vertices_.reserve(vertices_count);
+  depth_offsets_.reserve(graph.depth() + 1);
+  depth_offsets_.push_back(0);
+  for (auto depth = kDefaultDepth; depth <= graph.depth(); ++depth) {
+    for (const auto vertex_id : graph.vertices_at_depth_[depth]) {
+      vertices_.emplace_back(vertex_id);
+    }
+    depth_offsets_.push_back(vertices_.size());
+  }
+
+  depths_.assign(graph.depths_.cbegin(), graph.depths_.cend());
+
+  adjacency_offsets_.reserve(vertices_count + 1);
+  adjacency_offsets_.push_back(0);
+  for (const auto& edge_ids : graph.adjacency_list_) {
+    adjacency_offsets_.push_back(adjacency_offsets_.back() + edge_ids.size());
+  }
+  adjacency_edge_ids_.reserve(adjacency_offsets_.back());
+  for (const auto& edge_ids : graph.adjacency_list_) {
+    adjacency_edge_ids_.insert(adjacency_edge_ids_.end(), edge_ids.cbegin(),
+                               edge_ids.cend());
+  }
+
+  // Taking over the graph releases its whole arena at the end of the scope.
+  const auto released_graph = std::move(graph);
+}
+}  // namespace uni_course_cpp
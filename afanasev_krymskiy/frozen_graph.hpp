@@ -0,0 +1,68 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <vector>
+#include "graph.hpp"
+#include "span.hpp"
+
+namespace uni_course_cpp {
+// Immutable compact snapshot of a fully generated Graph. Adjacency is kept in
+// CSR form (one offsets array plus one edge id array), vertices are ordered
+// by depth, and none of the build-time indexes of Graph are retained.
+class FrozenGraph {
+ public:
+  using VertexId = Graph::VertexId;
+  using EdgeId = Graph::EdgeId;
+  using Depth = Graph::Depth;
+  using Vertex = Graph::Vertex;
+  using Edge = Graph::Edge;
+
+  explicit FrozenGraph(Graph&& graph);
+
+  // Vertices in depth order, the root first.
+  Span<Vertex> vertices() const { return vertices_; }
+
+  const Graph::EdgeTable& edges() const { return edges_; }
+
+  Span<EdgeId> connected_edge_ids(VertexId id) const {
+    assert(has_vertex(id));
+    return Span<EdgeId>(adjacency_edge_ids_.data() + adjacency_offsets_[id],
+                        adjacency_offsets_[id + 1] - adjacency_offsets_[id]);
+  }
+
+  Depth depth() const { return static_cast<Depth>(depth_offsets_.size()) - 1; }
+
+  Depth vertex_depth(VertexId vertex_id) const {
+    assert(has_vertex(vertex_id));
+    return depths_[vertex_id];
+  }
+
+  Span<Vertex> vertices_at_depth(Depth depth) const {
+    assert(depth >= 0 && depth <= this->depth());
+    const auto begin = depth == 0 ? 0 : depth_offsets_[depth - 1];
+    return Span<Vertex>(vertices_.data() + begin,
+                        depth_offsets_[depth] - begin);
+  }
+
+  std::size_t color_edges_count(Edge::Color color) const {
+    return stats_.color_edges_counts[static_cast<int>(color)];
+  }
+
+  const Graph::Stats& stats() const { return stats_; }
+
+ private:
+  bool has_vertex(VertexId vertex_id) const {
+    return vertex_id >= 0 &&
+           vertex_id < static_cast<VertexId>(depths_.size());
+  }
+
+  std::vector<Vertex> vertices_;
+  // depth_offsets_[depth] is the end of the depth's slice of vertices_.
+  std::vector<std::size_t> depth_offsets_;
+  std::vector<Depth> depths_;
+  std::vector<std::size_t> adjacency_offsets_;
+  std::vector<EdgeId> adjacency_edge_ids_;
+  Graph::EdgeTable edges_;
+  Graph::Stats stats_;
+};
+}  // namespace uni_course_cpp
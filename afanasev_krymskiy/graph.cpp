@@ -1,10 +1,22 @@
 #include "graph.hpp"
 #include <cassert>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <stdexcept>
-#include <unordered_map>
 #include <vector>
 
 namespace uni_course_cpp {
+Graph::Graph()
+    : memory_resource_(std::make_unique<std::pmr::monotonic_buffer_resource>()),
+      vertices_(memory_resource_.get()),
+      edges_(memory_resource_.get()),
+      neighbor_index_(memory_resource_.get()),
+      adjacency_list_(memory_resource_.get()),
+      depths_(memory_resource_.get()),
+      vertices_at_depth_(memory_resource_.get()),
+      positions_at_depth_(memory_resource_.get()) {}
+
 Graph::EdgeId Graph::add_edge(VertexId from_vertex_id, VertexId to_vertex_id) {
   assert(has_vertex(from_vertex_id));
   assert(has_vertex(to_vertex_id));
@@ -18,17 +30,118 @@ Graph::EdgeId Graph::add_edge(VertexId from_vertex_id, VertexId to_vertex_id) {
   const auto color = determine_color(from_vertex_id, to_vertex_id);
 
   const auto edge_id = next_edge_id();
-  adjacency_list_[from_vertex_id].push_back(edge_id);
+  add_connected_edge(from_vertex_id, edge_id);
   if (from_vertex_id != to_vertex_id) {
-    adjacency_list_[to_vertex_id].push_back(edge_id);
+    add_connected_edge(to_vertex_id, edge_id);
   }
 
-  edges_.try_emplace(edge_id, edge_id, from_vertex_id, to_vertex_id, color);
-  color_edge_ids_[color].push_back(edge_id);
+  edges_.add(from_vertex_id, to_vertex_id, color);
+  neighbor_index_.insert(from_vertex_id, to_vertex_id);
+  ++stats_.edges_count;
+  ++stats_.color_edges_counts[static_cast<int>(color)];
 
   return edge_id;
 }
 
+void Graph::add_edges(Span<VertexIdsPair> edges) {
+  const auto edges_count = edges.size();
+  const auto first_edge_id = current_edge_id_;
+
+  // First pass, in order: a vertex without edges moves one layer below the
+  // source of its first edge, as in add_edge. Every vertex moves at most
+  // once, before any of its edges is classified, so after this pass the
+  // depths are final for the whole batch. They are worked out on a copy and
+  // applied only once every edge has a color, so a rejected batch leaves
+  // the graph as it was.
+  auto depths = std::vector<Depth>(depths_.cbegin(), depths_.cend());
+  auto added_degrees = std::vector<std::size_t>(vertices_.size(), 0);
+  auto touched_vertex_ids = std::vector<VertexId>();
+  auto is_first_edge = std::vector<std::uint8_t>(edges_count, 0);
+  const auto touch = [&added_degrees, &touched_vertex_ids](VertexId id) {
+    if (added_degrees[id]++ == 0) {
+      touched_vertex_ids.push_back(id);
+    }
+  };
+  for (std::size_t i = 0; i < edges_count; ++i) {
+    const auto [from_vertex_id, to_vertex_id] = edges[i];
+    assert(has_vertex(from_vertex_id));
+    assert(has_vertex(to_vertex_id));
+    assert(!has_edge(from_vertex_id, to_vertex_id));
+    if (adjacency_list_[to_vertex_id].empty() &&
+        added_degrees[to_vertex_id] == 0) {
+      depths[to_vertex_id] = depths[from_vertex_id] + 1;
+      is_first_edge[i] = 1;
+    }
+    touch(from_vertex_id);
+    if (from_vertex_id != to_vertex_id) {
+      touch(to_vertex_id);
+    }
+  }
+
+  // Second pass: colors are a branch-free function of the flag and the two
+  // depths, which the compiler can vectorize.
+  constexpr auto kUnknownColor = static_cast<std::uint8_t>(Edge::kColorsCount);
+  auto colors = std::vector<std::uint8_t>(edges_count);
+  for (std::size_t i = 0; i < edges_count; ++i) {
+    const auto [from_vertex_id, to_vertex_id] = edges[i];
+    const auto depth_difference =
+        depths[to_vertex_id] - depths[from_vertex_id];
+    const auto by_depth =
+        depth_difference == kYellowEdgeDepth
+            ? static_cast<std::uint8_t>(Edge::Color::Yellow)
+            : depth_difference == kRedEdgeDepth
+                  ? static_cast<std::uint8_t>(Edge::Color::Red)
+                  : kUnknownColor;
+    const auto by_first_edge =
+        is_first_edge[i] ? static_cast<std::uint8_t>(Edge::Color::Grey)
+                         : by_depth;
+    colors[i] = from_vertex_id == to_vertex_id
+                    ? static_cast<std::uint8_t>(Edge::Color::Green)
+                    : by_first_edge;
+  }
+  for (const auto color : colors) {
+    if (color == kUnknownColor) {
+      throw std::runtime_error("Failed to determine color");
+    }
+  }
+
+  for (std::size_t i = 0; i < edges_count; ++i) {
+    if (is_first_edge[i]) {
+      const auto to_vertex_id = edges[i].second;
+      set_vertex_depth(to_vertex_id, depths[to_vertex_id]);
+    }
+  }
+
+  edges_.reserve(edges_.size() + edges_count);
+  neighbor_index_.reserve(edges_.size() + edges_count);
+  for (std::size_t i = 0; i < edges_count; ++i) {
+    const auto [from_vertex_id, to_vertex_id] = edges[i];
+    const auto color = static_cast<Edge::Color>(colors[i]);
+    edges_.add(from_vertex_id, to_vertex_id, color);
+    neighbor_index_.insert(from_vertex_id, to_vertex_id);
+    ++stats_.color_edges_counts[colors[i]];
+  }
+  stats_.edges_count += edges_count;
+  current_edge_id_ += edges_count;
+
+  // Every adjacency list grows once to its final size, then the edge ids
+  // are scattered in order.
+  for (const auto vertex_id : touched_vertex_ids) {
+    auto& edge_ids = adjacency_list_[vertex_id];
+    const auto new_degree = edge_ids.size() + added_degrees[vertex_id];
+    move_degree(edge_ids.size(), new_degree);
+    edge_ids.reserve(new_degree);
+  }
+  for (std::size_t i = 0; i < edges_count; ++i) {
+    const auto [from_vertex_id, to_vertex_id] = edges[i];
+    const auto edge_id = static_cast<EdgeId>(first_edge_id + i);
+    adjacency_list_[from_vertex_id].push_back(edge_id);
+    if (from_vertex_id != to_vertex_id) {
+      adjacency_list_[to_vertex_id].push_back(edge_id);
+    }
+  }
+}
+
 Graph::Depth Graph::depth() const {
   if (!vertices_at_depth_.empty()) {
     return vertices_at_depth_.size() - 1;
@@ -37,54 +150,101 @@ Graph::Depth Graph::depth() const {
 }
 
 bool Graph::has_edge(VertexId from_vertex_id, VertexId to_vertex_id) const {
-  assert(adjacency_list_.find(from_vertex_id) != adjacency_list_.end());
-  assert(adjacency_list_.find(to_vertex_id) != adjacency_list_.end());
-  if (from_vertex_id != to_vertex_id) {
-    const auto& connected_from_edges_ids = adjacency_list_.at(from_vertex_id);
-    const auto& connected_to_edges_ids = adjacency_list_.at(to_vertex_id);
-    for (const auto from_edge_id : connected_from_edges_ids) {
-      for (const auto to_edge_id : connected_to_edges_ids) {
-        if (from_edge_id == to_edge_id) {
-          return true;
-        }
-      }
-    }
-  } else {
-    const auto& edges_ids = adjacency_list_.at(from_vertex_id);
-    for (const auto edge_id : edges_ids) {
-      if (edges_.at(edge_id).from_vertex_id() ==
-          edges_.at(edge_id).to_vertex_id()) {
-        return true;
-      }
-    }
-  }
-  return false;
+  assert(has_vertex(from_vertex_id));
+  assert(has_vertex(to_vertex_id));
+  return neighbor_index_.contains(from_vertex_id, to_vertex_id);
+}
+
+void Graph::reserve(std::size_t vertices_count, std::size_t edges_count) {
+  vertices_.reserve(vertices_count);
+  adjacency_list_.reserve(vertices_count);
+  depths_.reserve(vertices_count);
+  positions_at_depth_.reserve(vertices_count);
+  edges_.reserve(edges_count);
+  neighbor_index_.reserve(edges_count);
 }
 
 Graph::VertexId Graph::add_vertex() {
   const auto vertex_id = next_vertex_id();
-  vertices_.try_emplace(vertex_id, vertex_id);
-  adjacency_list_[vertex_id] = {};
-  set_vertex_depth(vertex_id, kDefaultDepth);
+  vertices_.emplace_back(vertex_id);
+  adjacency_list_.emplace_back();
+  depths_.push_back(kDefaultDepth);
+  positions_at_depth_.push_back(0);
+  add_to_depth(vertex_id, kDefaultDepth);
+  ++stats_.vertices_count;
+  if (stats_.degree_vertices_counts.empty()) {
+    stats_.degree_vertices_counts.push_back(0);
+  }
+  ++stats_.degree_vertices_counts[0];
   return vertex_id;
 }
 
+Graph::VertexId Graph::add_vertices(std::size_t count) {
+  const auto first_vertex_id = current_vertex_id_;
+  const auto vertices_count = vertices_.size() + count;
+  reserve(vertices_count, edges_.size());
+  if (vertices_at_depth_.size() <= kDefaultDepth) {
+    vertices_at_depth_.resize(kDefaultDepth + 1);
+    stats_.depth_vertices_counts.resize(kDefaultDepth + 1);
+  }
+  auto& default_depth_vertices = vertices_at_depth_[kDefaultDepth];
+  default_depth_vertices.reserve(default_depth_vertices.size() + count);
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto vertex_id = next_vertex_id();
+    vertices_.emplace_back(vertex_id);
+    positions_at_depth_.push_back(default_depth_vertices.size());
+    default_depth_vertices.push_back(vertex_id);
+  }
+  adjacency_list_.resize(vertices_count);
+  depths_.resize(vertices_count, kDefaultDepth);
+
+  stats_.vertices_count += count;
+  stats_.depth_vertices_counts[kDefaultDepth] += count;
+  if (stats_.degree_vertices_counts.empty()) {
+    stats_.degree_vertices_counts.push_back(0);
+  }
+  stats_.degree_vertices_counts[0] += count;
+  return first_vertex_id;
+}
+
+void Graph::add_connected_edge(VertexId vertex_id, EdgeId edge_id) {
+  auto& edge_ids = adjacency_list_[vertex_id];
+  move_degree(edge_ids.size(), edge_ids.size() + 1);
+  edge_ids.push_back(edge_id);
+}
+
+void Graph::move_degree(std::size_t old_degree, std::size_t new_degree) {
+  auto& degree_vertices_counts = stats_.degree_vertices_counts;
+  --degree_vertices_counts[old_degree];
+  if (new_degree >= degree_vertices_counts.size()) {
+    degree_vertices_counts.resize(new_degree + 1);
+  }
+  ++degree_vertices_counts[new_degree];
+}
+
 void Graph::set_vertex_depth(VertexId vertex_id, Depth depth) {
+  // Swap-remove the vertex from its current layer, so moving a vertex out of
+  // the (large) default layer is O(1).
+  auto& old_depth_vertices = vertices_at_depth_[depths_[vertex_id]];
+  const auto position = positions_at_depth_[vertex_id];
+  const auto last_vertex_id = old_depth_vertices.back();
+  old_depth_vertices[position] = last_vertex_id;
+  positions_at_depth_[last_vertex_id] = position;
+  old_depth_vertices.pop_back();
+  --stats_.depth_vertices_counts[depths_[vertex_id]];
+
+  add_to_depth(vertex_id, depth);
+}
+
+void Graph::add_to_depth(VertexId vertex_id, Depth depth) {
   depths_[vertex_id] = depth;
-  if (depth >= vertices_at_depth_.size()) {
+  if (depth >= static_cast<Depth>(vertices_at_depth_.size())) {
     vertices_at_depth_.resize(depth + 1);
+    stats_.depth_vertices_counts.resize(depth + 1);
   }
+  positions_at_depth_[vertex_id] = vertices_at_depth_[depth].size();
   vertices_at_depth_[depth].push_back(vertex_id);
-  if (depth != kDefaultDepth) {
-    for (auto vertex_id_iterator = vertices_at_depth_[kDefaultDepth].cbegin();
-         vertex_id_iterator != vertices_at_depth_[kDefaultDepth].cend();
-         ++vertex_id_iterator) {
-      if (*vertex_id_iterator == vertex_id) {
-        vertices_at_depth_[kDefaultDepth].erase(vertex_id_iterator);
-        break;
-      }
-    }
-  }
+  ++stats_.depth_vertices_counts[depth];
 }
 
 Graph::Edge::Color Graph::determine_color(VertexId from_vertex_id,
@@ -107,12 +267,82 @@ Graph::Edge::Color Graph::determine_color(VertexId from_vertex_id,
   throw std::runtime_error("Failed to determine color");
 }
 
-const std::vector<Graph::EdgeId>& Graph::color_edge_ids(
-    Graph::Edge::Color color) const {
-  if (color_edge_ids_.find(color) != color_edge_ids_.end()) {
-    return color_edge_ids_.at(color);
+Graph::EdgeId Graph::EdgeTable::add(VertexId from_vertex_id,
+                                    VertexId to_vertex_id,
+                                    Edge::Color color) {
+  const auto edge_id = static_cast<EdgeId>(size());
+  from_vertex_ids_.push_back(from_vertex_id);
+  to_vertex_ids_.push_back(to_vertex_id);
+  if (edge_id % kColorsPerWord == 0) {
+    colors_.push_back(0);
+  }
+  const auto shift = (edge_id % kColorsPerWord) * kColorBits;
+  colors_.back() |= static_cast<ColorWord>(color) << shift;
+  return edge_id;
+}
+
+void Graph::EdgeTable::reserve(std::size_t edges_count) {
+  from_vertex_ids_.reserve(edges_count);
+  to_vertex_ids_.reserve(edges_count);
+  colors_.reserve((edges_count + kColorsPerWord - 1) / kColorsPerWord);
+}
+
+void Graph::NeighborIndex::insert(VertexId first_vertex_id,
+                                  VertexId second_vertex_id) {
+  // Keep the load factor at or below 1/2 so probe sequences stay short.
+  if (2 * (size_ + 1) > slots_.size()) {
+    rehash(slots_.empty() ? kMinCapacityBits : capacity_bits_ + 1);
+  }
+  insert_key(make_key(first_vertex_id, second_vertex_id));
+  ++size_;
+}
+
+bool Graph::NeighborIndex::contains(VertexId first_vertex_id,
+                                    VertexId second_vertex_id) const {
+  if (slots_.empty()) {
+    return false;
+  }
+  const auto key = make_key(first_vertex_id, second_vertex_id);
+  const auto mask = slots_.size() - 1;
+  for (auto index = slot_index(key);; index = (index + 1) & mask) {
+    if (slots_[index] == key) {
+      return true;
+    }
+    if (slots_[index] == kEmptyKey) {
+      return false;
+    }
+  }
+}
+
+void Graph::NeighborIndex::reserve(std::size_t pairs_count) {
+  auto capacity_bits = kMinCapacityBits;
+  while ((std::size_t(1) << capacity_bits) < 2 * pairs_count) {
+    ++capacity_bits;
+  }
+  if (capacity_bits > capacity_bits_) {
+    rehash(capacity_bits);
+  }
+}
+
+void Graph::NeighborIndex::insert_key(Key key) {
+  const auto mask = slots_.size() - 1;
+  auto index = slot_index(key);
+  while (slots_[index] != kEmptyKey) {
+    assert(slots_[index] != key);
+    index = (index + 1) & mask;
+  }
+  slots_[index] = key;
+}
+
+void Graph::NeighborIndex::rehash(int capacity_bits) {
+  auto old_slots = std::pmr::vector<Key>(slots_.get_allocator());
+  old_slots.swap(slots_);
+  capacity_bits_ = capacity_bits;
+  slots_.assign(std::size_t(1) << capacity_bits_, kEmptyKey);
+  for (const auto key : old_slots) {
+    if (key != kEmptyKey) {
+      insert_key(key);
+    }
   }
-  static std::vector<EdgeId> empty_vector;
-  return empty_vector;
 }
 }  // namespace uni_course_cpp
@@ -1,13 +1,24 @@
 #pragma once
-#include <unordered_map>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <utility>
 #include <vector>
+#include "span.hpp"
 
 namespace uni_course_cpp {
+class FrozenGraph;
+
 class Graph {
  public:
   using VertexId = int;
   using EdgeId = int;
   using Depth = int;
+  using VertexIdsPair = std::pair<VertexId, VertexId>;
 
   struct Vertex {
    public:
@@ -20,7 +31,8 @@ class Graph {
 
   struct Edge {
    public:
-    enum class Color { Grey, Green, Yellow, Red };
+    enum class Color : std::uint8_t { Grey, Green, Yellow, Red };
+    static constexpr int kColorsCount = 4;
 
     Edge(EdgeId id, VertexId from_vertex_id, VertexId to_vertex_id, Color color)
         : id_(id),
@@ -40,33 +52,168 @@ class Graph {
     Color color_ = Color::Grey;
   };
 
+  // Struct-of-arrays storage for edges: endpoints live in two separate
+  // columns and colors are packed 2 bits each, 32 per word, so a scan over
+  // one attribute touches only that attribute.
+  class EdgeTable {
+   public:
+    using ColorWord = std::uint64_t;
+    static constexpr int kColorBits = 2;
+    static constexpr int kColorsPerWord = sizeof(ColorWord) * 8 / kColorBits;
+
+    class Iterator {
+     public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = Edge;
+      using difference_type = std::ptrdiff_t;
+      using pointer = void;
+      using reference = Edge;
+
+      Iterator(const EdgeTable& table, EdgeId id) : table_(&table), id_(id) {}
+
+      Edge operator*() const { return (*table_)[id_]; }
+      Iterator& operator++() {
+        ++id_;
+        return *this;
+      }
+      bool operator==(const Iterator& other) const { return id_ == other.id_; }
+      bool operator!=(const Iterator& other) const { return id_ != other.id_; }
+
+     private:
+      const EdgeTable* table_ = nullptr;
+      EdgeId id_ = 0;
+    };
+
+    explicit EdgeTable(std::pmr::memory_resource* memory_resource =
+                           std::pmr::get_default_resource())
+        : from_vertex_ids_(memory_resource),
+          to_vertex_ids_(memory_resource),
+          colors_(memory_resource) {}
+
+    EdgeId add(VertexId from_vertex_id,
+               VertexId to_vertex_id,
+               Edge::Color color);
+
+    std::size_t size() const { return from_vertex_ids_.size(); }
+    bool empty() const { return from_vertex_ids_.empty(); }
+
+    Edge operator[](EdgeId id) const {
+      return Edge(id, from_vertex_id(id), to_vertex_id(id), color(id));
+    }
+
+    VertexId from_vertex_id(EdgeId id) const {
+      assert(has_edge_id(id));
+      return from_vertex_ids_[id];
+    }
+    VertexId to_vertex_id(EdgeId id) const {
+      assert(has_edge_id(id));
+      return to_vertex_ids_[id];
+    }
+    Edge::Color color(EdgeId id) const {
+      assert(has_edge_id(id));
+      const auto shift = (id % kColorsPerWord) * kColorBits;
+      return static_cast<Edge::Color>((colors_[id / kColorsPerWord] >> shift) &
+                                      kColorMask);
+    }
+
+    Span<VertexId> from_vertex_ids() const { return from_vertex_ids_; }
+    Span<VertexId> to_vertex_ids() const { return to_vertex_ids_; }
+    Span<ColorWord> packed_colors() const { return colors_; }
+
+    void reserve(std::size_t edges_count);
+
+    Iterator begin() const { return Iterator(*this, 0); }
+    Iterator end() const {
+      return Iterator(*this, static_cast<EdgeId>(size()));
+    }
+
+   private:
+    static constexpr ColorWord kColorMask = (1 << kColorBits) - 1;
+
+    bool has_edge_id(EdgeId id) const {
+      return id >= 0 && id < static_cast<EdgeId>(size());
+    }
+
+    std::pmr::vector<VertexId> from_vertex_ids_;
+    std::pmr::vector<VertexId> to_vertex_ids_;
+    std::pmr::vector<ColorWord> colors_;
+  };
+
+  // Aggregates kept up to date on every mutation, so that summaries are
+  // O(depth) instead of a walk over the whole graph.
+  struct Stats {
+    Depth depth() const {
+      return depth_vertices_counts.empty()
+                 ? 0
+                 : static_cast<Depth>(depth_vertices_counts.size()) - 1;
+    }
+
+    std::size_t vertices_count = 0;
+    std::size_t edges_count = 0;
+    // Indexed by depth, like vertices_at_depth().
+    std::vector<std::size_t> depth_vertices_counts;
+    std::array<std::size_t, Edge::kColorsCount> color_edges_counts = {};
+    // degree_vertices_counts[degree] is the number of vertices with exactly
+    // `degree` connected edges.
+    std::vector<std::size_t> degree_vertices_counts;
+  };
+
+  // Everything a graph allocates, including the per-vertex adjacency
+  // vectors, comes from its own monotonic arena, which is released at once
+  // when the graph is destroyed. A moved-from graph may only be destroyed.
+  Graph();
+  Graph(Graph&&) = default;
+  Graph& operator=(Graph&&) = delete;
+
   VertexId add_vertex();
 
+  // Adds `count` vertices with consecutive ids and returns the first one.
+  VertexId add_vertices(std::size_t count);
+
   EdgeId add_edge(VertexId, VertexId);
 
-  const std::vector<EdgeId>& connected_edge_ids(VertexId id) const {
-    return adjacency_list_.at(id);
-  }
+  // Adds the edges in order with the same outcome as add_edge one by one,
+  // but grows every container once for the whole batch and fills the
+  // adjacency lists in a single scatter.
+  void add_edges(Span<VertexIdsPair> edges);
+
+  // Pre-sizes the per-vertex and per-edge containers so that generation
+  // does not pay for regrowth and rehashing.
+  void reserve(std::size_t vertices_count, std::size_t edges_count);
 
-  const std::unordered_map<VertexId, Vertex>& vertices() const {
-    return vertices_;
+  // Vertex and edge ids are handed out sequentially, so every per-vertex and
+  // per-edge container below is a plain vector indexed by id.
+  const std::pmr::vector<EdgeId>& connected_edge_ids(VertexId id) const {
+    assert(has_vertex(id));
+    return adjacency_list_[id];
   }
 
-  const std::unordered_map<EdgeId, Edge>& edges() const { return edges_; }
+  const std::pmr::vector<Vertex>& vertices() const { return vertices_; }
+
+  const EdgeTable& edges() const { return edges_; }
 
   Depth depth() const;
 
-  Depth vertex_depth(VertexId vertex_id) const { return depths_.at(vertex_id); }
+  Depth vertex_depth(VertexId vertex_id) const {
+    assert(has_vertex(vertex_id));
+    return depths_[vertex_id];
+  }
 
-  const std::vector<VertexId>& vertices_at_depth(Depth depth) const {
+  const std::pmr::vector<VertexId>& vertices_at_depth(Depth depth) const {
     return vertices_at_depth_.at(depth);
   }
 
   bool has_edge(VertexId, VertexId) const;
 
-  const std::vector<EdgeId>& color_edge_ids(Edge::Color color) const;
+  std::size_t color_edges_count(Edge::Color color) const {
+    return stats_.color_edges_counts[static_cast<int>(color)];
+  }
+
+  const Stats& stats() const { return stats_; }
 
  private:
+  friend class FrozenGraph;
+
   VertexId current_vertex_id_ = 0;
   EdgeId current_edge_id_ = 0;
 
@@ -75,19 +222,66 @@ class Graph {
   EdgeId next_edge_id() { return current_edge_id_++; }
 
   bool has_vertex(VertexId vertex_id) const {
-    return vertices_.find(vertex_id) != vertices_.end();
+    return vertex_id >= 0 &&
+           vertex_id < static_cast<VertexId>(vertices_.size());
   }
 
   void set_vertex_depth(VertexId, Depth);
+  void add_to_depth(VertexId, Depth);
+  void add_connected_edge(VertexId, EdgeId);
+  void move_degree(std::size_t old_degree, std::size_t new_degree);
 
   Edge::Color determine_color(VertexId, VertexId) const;
 
-  std::unordered_map<VertexId, Vertex> vertices_;
-  std::unordered_map<EdgeId, Edge> edges_;
-  std::unordered_map<VertexId, std::vector<EdgeId>> adjacency_list_;
-  std::unordered_map<VertexId, Depth> depths_;
-  std::vector<std::vector<VertexId>> vertices_at_depth_;
-  std::unordered_map<Edge::Color, std::vector<EdgeId>> color_edge_ids_;
+  // Open-addressing hash set of unordered vertex pairs, one per edge, so
+  // that has_edge is a short linear probe instead of intersecting the two
+  // adjacency lists.
+  class NeighborIndex {
+   public:
+    explicit NeighborIndex(std::pmr::memory_resource* memory_resource)
+        : slots_(memory_resource) {}
+
+    void insert(VertexId, VertexId);
+    bool contains(VertexId, VertexId) const;
+    void reserve(std::size_t pairs_count);
+
+   private:
+    using Key = std::uint64_t;
+    static constexpr Key kEmptyKey = ~Key(0);
+    static constexpr int kMinCapacityBits = 4;
+
+    static Key make_key(VertexId first_vertex_id, VertexId second_vertex_id) {
+      if (first_vertex_id > second_vertex_id) {
+        std::swap(first_vertex_id, second_vertex_id);
+      }
+      return (static_cast<Key>(first_vertex_id) << 32) |
+             static_cast<std::uint32_t>(second_vertex_id);
+    }
+
+    std::size_t slot_index(Key key) const {
+      // Fibonacci hashing: the high bits of the product are well mixed.
+      return (key * 0x9E3779B97F4A7C15ull) >> (64 - capacity_bits_);
+    }
+
+    void insert_key(Key);
+    void rehash(int capacity_bits);
+
+    std::pmr::vector<Key> slots_;
+    std::size_t size_ = 0;
+    int capacity_bits_ = 0;
+  };
+
+  // Declared first so that it outlives every container allocating from it.
+  std::unique_ptr<std::pmr::monotonic_buffer_resource> memory_resource_;
+  std::pmr::vector<Vertex> vertices_;
+  EdgeTable edges_;
+  NeighborIndex neighbor_index_;
+  std::pmr::vector<std::pmr::vector<EdgeId>> adjacency_list_;
+  std::pmr::vector<Depth> depths_;
+  std::pmr::vector<std::pmr::vector<VertexId>> vertices_at_depth_;
+  // Index of each vertex inside vertices_at_depth_[depths_[vertex_id]].
+  std::pmr::vector<int> positions_at_depth_;
+  Stats stats_;
 };
 
 constexpr Graph::Depth kYellowEdgeDepth = 1;
@@ -1,93 +1,148 @@
-#include <atomic>
-#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory_resource>
 #include <mutex>
-#include <optional>
-#include <thread>
+#include <vector>
 
+#include "graph.hpp"
 #include "graph_generation_controller.hpp"
+#include "graph_generator.hpp"
+#include "random_stream.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+using uni_course_cpp::Graph;
+
+// A reservation lasts until the graph's JSON file is written, so every
+// stage is counted: the Graph, its FrozenGraph copy and the JSON string.
+// Their sum bounds whichever of them are alive at once.
+
+// Graph containers per vertex and per edge.
+constexpr std::size_t kGraphBytesPerVertex =
+    sizeof(Graph::Vertex) + sizeof(Graph::Depth) + sizeof(Graph::VertexId) +
+    sizeof(int) + sizeof(std::pmr::vector<Graph::EdgeId>);
+constexpr std::size_t kGraphBytesPerEdge =
+    2 * sizeof(Graph::VertexId) + 2 * sizeof(Graph::EdgeId) +
+    2 * sizeof(std::uint64_t);
+// The Graph's monotonic arena never reuses freed memory and grows by
+// doubling its chunks, so it may hold up to twice what its containers use.
+constexpr double kArenaSlackFactor = 2;
+
+// FrozenGraph columns and CSR adjacency per vertex and per edge.
+constexpr std::size_t kFrozenBytesPerVertex =
+    sizeof(Graph::Vertex) + sizeof(Graph::Depth) + sizeof(std::size_t);
+constexpr std::size_t kFrozenBytesPerEdge =
+    2 * sizeof(Graph::VertexId) + 1 + 2 * sizeof(Graph::EdgeId);
+
+// Printed JSON per vertex, `{"id":…,"edge_ids":[],"depth": …},`, and per
+// edge, its object plus its id in the lists of both ends, with ids of up to
+// seven digits.
+constexpr std::size_t kJsonBytesPerVertex = 40;
+constexpr std::size_t kJsonBytesPerEdge = 72;
+// The string is built by appending, so its buffer may be twice its length.
+constexpr double kStringGrowthFactor = 2;
+
+std::size_t get_estimated_bytes(
+    const uni_course_cpp::GraphGenerator::SizeEstimate& estimate) {
+  const auto vertices_count = estimate.expected_vertices_count;
+  const auto edges_count = estimate.expected_edges_count;
+  const auto graph_bytes =
+      kArenaSlackFactor * (vertices_count * kGraphBytesPerVertex +
+                           edges_count * kGraphBytesPerEdge);
+  const auto frozen_bytes = vertices_count * kFrozenBytesPerVertex +
+                            edges_count * kFrozenBytesPerEdge;
+  const auto json_bytes =
+      kStringGrowthFactor * (vertices_count * kJsonBytesPerVertex +
+                             edges_count * kJsonBytesPerEdge);
+  return static_cast<std::size_t>(graph_bytes + frozen_bytes + json_bytes);
+}
+}  // namespace
 
 namespace uni_course_cpp {
 GraphGenerationController::GraphGenerationController(
     int threads_count,
     int graphs_count,
-    GraphGenerator::Params&& params)
+    GraphGenerator::Params&& params,
+    const Limits& limits)
     : threads_count_(threads_count),
       graphs_count_(graphs_count),
-      graph_generator_(std::move(params)) {
-  const auto job_optional = [&mutex_for_jobs = mutex_for_jobs_,
-                             &jobs = jobs_]() -> std::optional<JobCallback> {
-    const std::lock_guard lock(mutex_for_jobs);
-    if (!jobs.empty()) {
-      const auto item = jobs.back();
-      jobs.pop_back();
-      return item;
-    }
-    return std::nullopt;
-  };
+      params_(std::move(params)),
+      limits_(limits) {}
 
-  for (int i = 0; i < threads_count; ++i)
-    workers_.emplace_back(job_optional);
-}
 void GraphGenerationController::generate(
     const GenStartedCallback& gen_started_callback,
     const GenFinishedCallback& gen_finished_callback) {
-  std::atomic<int> wait_for_jobs_count = graphs_count_;
+  // All graphs share the params, so they are estimated once.
+  const auto graph_bytes = get_estimated_bytes(
+      GraphGenerator(GraphGenerator::Params(params_)).estimate_size());
 
+  // The graphs are admitted here rather than inside the pool: a task that
+  // blocked on the limits could be run by a worker waiting on a graph that
+  // holds them, and never be woken.
   std::mutex callback_mutex;
-  for (int index = 0; index < graphs_count_; ++index)
-    jobs_.emplace_back([&gen_started_callback, &gen_finished_callback,
-                        &wait_for_jobs_count, &callback_mutex, index,
-                        &graph_generator = graph_generator_]() {
+  auto& thread_pool = ThreadPool::get_thread_pool();
+  auto task_group = ThreadPool::TaskGroup();
+  for (int index = 0; index < graphs_count_; ++index) {
+    acquire(graph_bytes);
+    thread_pool.submit(task_group, [this, &gen_started_callback,
+                                    &gen_finished_callback, &callback_mutex,
+                                    index, graph_bytes]() {
       {
         const std::lock_guard lock(callback_mutex);
         gen_started_callback(index);
       }
+      const auto graph_generator = GraphGenerator(GraphGenerator::Params(
+          params_.get_depth(), params_.new_vertices_count(),
+          RandomStream::derive_seed(params_.seed(), index),
+          params_.grey_tree_mode()));
       auto graph = graph_generator.generate();
+      finish_generation();
       {
         const std::lock_guard lock(callback_mutex);
-        gen_finished_callback(index, std::move(graph));
+        gen_finished_callback(index, std::move(graph),
+                              Reservation(*this, graph_bytes));
       }
-      --wait_for_jobs_count;
     });
-
-  for (auto& worker : workers_)
-    worker.start();
-
-  while (wait_for_jobs_count)
-    ;
-
-  for (auto& worker : workers_)
-    worker.stop();
+  }
+  thread_pool.wait(task_group);
 }
 
-void GraphGenerationController::Worker::start() {
-  assert(state_ == State::Idle);
+GraphGenerationController::Reservation::~Reservation() {
+  if (controller_ != nullptr)
+    controller_->release(bytes_);
+}
 
-  state_ = State::Working;
-  thread_ =
-      std::thread([&state = state_, &get_job_callback = get_job_callback_]() {
-        while (true) {
-          if (state == State::ShouldTerminate)
-            return;
-          const auto job_optional = get_job_callback();
-          if (job_optional.has_value()) {
-            const auto& job = job_optional.value();
-            job();
-          }
-        }
-      });
+void GraphGenerationController::acquire(std::size_t bytes) {
+  std::unique_lock lock(mutex_for_limits_);
+  // A graph larger than the whole byte budget still runs, but alone.
+  limits_condition_.wait(lock, [this, bytes]() {
+    return generating_graphs_count_ < threads_count_ &&
+           (limits_.max_graphs_count() == 0 ||
+            held_graphs_count_ < limits_.max_graphs_count()) &&
+           (limits_.max_bytes() == 0 || held_graphs_count_ == 0 ||
+            held_bytes_ + bytes <= limits_.max_bytes());
+  });
+  ++generating_graphs_count_;
+  ++held_graphs_count_;
+  held_bytes_ += bytes;
 }
 
-void GraphGenerationController::Worker::stop() {
-  assert(state_ == State::Working);
-  state_ = State::ShouldTerminate;
-  thread_.join();
-  state_ = State::Idle;
+void GraphGenerationController::finish_generation() {
+  {
+    const std::lock_guard lock(mutex_for_limits_);
+    --generating_graphs_count_;
+  }
+  limits_condition_.notify_all();
 }
 
-GraphGenerationController::Worker::~Worker() {
-  if (state_ == State::Working)
-    stop();
+void GraphGenerationController::release(std::size_t bytes) {
+  {
+    const std::lock_guard lock(mutex_for_limits_);
+    --held_graphs_count_;
+    held_bytes_ -= bytes;
+  }
+  limits_condition_.notify_all();
 }
 }  // namespace uni_course_cpp
@@ -1,57 +1,90 @@
 #pragma once
 
-#include <atomic>
-#include <cassert>
+#include <condition_variable>
+#include <cstddef>
 #include <functional>
-#include <list>
 #include <mutex>
-#include <optional>
-#include <thread>
+#include <utility>
 
 #include "graph.hpp"
 #include "graph_generator.hpp"
 
 namespace uni_course_cpp {
+// Generates graphs on the shared thread pool, at most `threads_count` of
+// them at a time. Every graph's own parallel work goes to the same pool.
 class GraphGenerationController {
  public:
-  using GenStartedCallback = std::function<void(int index)>;
-  using GenFinishedCallback = std::function<void(int index, Graph&& graph)>;
+  // A finished graph's share of the limits, handed to the finished callback
+  // along with the graph. It is given back when the last reservation moved
+  // from it is destroyed, so a consumer keeps it until it is done with
+  // everything made from the graph.
+  class Reservation {
+   public:
+    Reservation(Reservation&& other) noexcept
+        : controller_(std::exchange(other.controller_, nullptr)),
+          bytes_(other.bytes_) {}
+    Reservation(const Reservation& other) = delete;
+    void operator=(const Reservation& other) = delete;
+    void operator=(Reservation&& other) = delete;
+    ~Reservation();
 
-  GraphGenerationController(int threads_count,
-                            int graphs_count,
-                            GraphGenerator::Params&& params);
+   private:
+    friend class GraphGenerationController;
 
-  void generate(const GenStartedCallback& gen_started_callback,
-                const GenFinishedCallback& gen_finished_callback);
+    Reservation(GraphGenerationController& controller, std::size_t bytes)
+        : controller_(&controller), bytes_(bytes) {}
 
- private:
-  using JobCallback = std::function<void()>;
+    GraphGenerationController* controller_ = nullptr;
+    std::size_t bytes_ = 0;
+  };
+
+  using GenStartedCallback = std::function<void(int index)>;
+  using GenFinishedCallback = std::function<
+      void(int index, Graph&& graph, Reservation&& reservation)>;
 
-  class Worker {
+  // Caps the graphs held at once, each from the start of its generation
+  // until its reservation is destroyed. Graphs over the cap wait for
+  // earlier ones to be released. Zero means no cap; threads_count bounds
+  // the graphs being generated either way.
+  class Limits {
    public:
-    using GetJobCallback = std::function<std::optional<JobCallback>()>;
+    explicit Limits(int max_graphs_count = 0, std::size_t max_bytes = 0)
+        : max_graphs_count_(max_graphs_count), max_bytes_(max_bytes) {}
 
-    explicit Worker(const GetJobCallback& get_job_callback)
-        : get_job_callback_(get_job_callback) {}
+    int max_graphs_count() const { return max_graphs_count_; }
+    // Compared with a size estimated from the params, not measured, which
+    // covers the graph, its frozen copy and its JSON string.
+    std::size_t max_bytes() const { return max_bytes_; }
 
-    void start();
-    void stop();
+   private:
+    int max_graphs_count_ = 0;
+    std::size_t max_bytes_ = 0;
+  };
 
-    ~Worker();
+  GraphGenerationController(int threads_count,
+                            int graphs_count,
+                            GraphGenerator::Params&& params,
+                            const Limits& limits = Limits());
 
-   private:
-    enum class State { Idle, Working, ShouldTerminate };
+  void generate(const GenStartedCallback& gen_started_callback,
+                const GenFinishedCallback& gen_finished_callback);
 
-    std::thread thread_;
-    GetJobCallback get_job_callback_;
-    State state_ = State::Idle;
-  };
+ private:
+  // Blocks until a thread is free and a graph of `bytes` fits into the
+  // limits, then holds both.
+  void acquire(std::size_t bytes);
+  void finish_generation();
+  void release(std::size_t bytes);
 
-  std::list<Worker> workers_;
-  std::list<JobCallback> jobs_;
   int threads_count_;
   int graphs_count_;
-  std::mutex mutex_for_jobs_;
-  GraphGenerator graph_generator_;
+  // Graph i is generated with a seed derived from the params' seed and i.
+  GraphGenerator::Params params_;
+  Limits limits_;
+  int generating_graphs_count_ = 0;
+  int held_graphs_count_ = 0;
+  std::size_t held_bytes_ = 0;
+  std::mutex mutex_for_limits_;
+  std::condition_variable limits_condition_;
 };
 }  // namespace uni_course_cpp
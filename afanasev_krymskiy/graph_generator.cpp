@@ -1,38 +1,75 @@
 #include "graph_generator.hpp"
 #include <algorithm>
-#include <atomic>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
-#include <list>
-#include <mutex>
+#include <numeric>
 #include <optional>
-#include <random>
-#include <thread>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 #include "config.hpp"
 #include "graph.hpp"
+#include "random_stream.hpp"
+#include "sampling.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
 
 namespace {
-static const int kMaxThreadsCount = std::thread::hardware_concurrency();
-bool check_probability(double probability) {
-  std::random_device device;
-  std::mt19937 generator(device());
-  std::bernoulli_distribution distribution(probability);
-  return distribution(generator);
+// Graphs are reserved slightly above the expected size, so that the typical
+// graph never regrows while a huge upper bound is never allocated.
+constexpr double kReserveFactor = 1.1;
+// Layers are split into chunks of a fixed size, each generated with a stream
+// of its own, so that the graph does not depend on the threads count.
+constexpr int kLayerChunkSize = 1024;
+// Random yellow targets that are already connected are redrawn this many
+// times before the unconnected ones are listed exactly.
+constexpr int kMaxYellowRejectionsCount = 8;
+// Depth-first grey branches whose expected size reaches this many vertices
+// are split off into tasks of their own.
+constexpr double kMinGreyTaskSize = 1024;
+
+float get_grey_edge_probability(uni_course_cpp::Graph::Depth depth,
+                                uni_course_cpp::Graph::Depth parent_depth) {
+  return (depth - parent_depth) / (depth - 1.f);
+}
+
+float get_yellow_edge_probability(uni_course_cpp::Graph::Depth graph_depth,
+                                  uni_course_cpp::Graph::Depth vertex_depth) {
+  return (vertex_depth - 1) / (graph_depth - 2.f);
+}
+
+// Every phase of the generation draws from its own family of streams.
+enum class StreamKind : std::uint64_t {
+  Grey = 1,
+  Green,
+  Yellow,
+  Red,
+  GreyLayer,
+  Stats
+};
+
+std::uint64_t get_stream_id(StreamKind kind, std::uint64_t index) {
+  return (static_cast<std::uint64_t>(kind) << 32) | index;
 }
 
 uni_course_cpp::Graph::VertexId get_random_vertex_id(
-    const std::vector<uni_course_cpp::Graph::VertexId>& list) {
-  std::random_device device;
-  std::mt19937 generator(device());
-  std::uniform_int_distribution<> distribution(0, list.size() - 1);
-  return list[distribution(generator)];
+    uni_course_cpp::RandomStream& stream,
+    uni_course_cpp::Span<uni_course_cpp::Graph::VertexId> list) {
+  return list[stream.uniform_index(list.size())];
 }
 
+// The color passes only need a few queries of the graph: the graph depth,
+// the vertices of a layer and adjacency between neighbouring layers. They
+// are templates over that view, so that both a Graph and the layer window of
+// the streaming mode can back them.
+template <typename GraphView>
 std::vector<uni_course_cpp::Graph::VertexId> get_unconnected_vertices_ids(
-    const uni_course_cpp::Graph& graph,
+    const GraphView& graph,
     uni_course_cpp::Graph::VertexId vertex_id,
-    const std::vector<uni_course_cpp::Graph::VertexId>& vertices_ids) {
+    uni_course_cpp::Span<uni_course_cpp::Graph::VertexId> vertices_ids) {
   std::vector<uni_course_cpp::Graph::VertexId> result;
   for (const auto vertex_id_depth_greater : vertices_ids) {
     if (!graph.has_edge(vertex_id, vertex_id_depth_greater)) {
@@ -42,166 +79,803 @@ std::vector<uni_course_cpp::Graph::VertexId> get_unconnected_vertices_ids(
   return result;
 }
 
-void generate_green_edges(uni_course_cpp::Graph& graph,
-                          std::mutex& mutex_for_graph) {
-  std::for_each(
-      graph.vertices().cbegin(), graph.vertices().cend(),
-      [&graph, &mutex_for_graph](const auto& vertices_item) {
-        if (check_probability(uni_course_cpp::config::kGreenEdgesProbability)) {
-          const std::lock_guard lock(mutex_for_graph);
-          graph.add_edge(vertices_item.first, vertices_item.first);
+// Uniform among the unconnected targets. Vertices are connected to few of
+// the next layer, so a random target is usually accepted at once and the
+// list is only built for the rare vertex adjacent to most of the layer.
+template <typename GraphView>
+std::optional<uni_course_cpp::Graph::VertexId> get_random_unconnected_vertex_id(
+    const GraphView& graph,
+    uni_course_cpp::RandomStream& stream,
+    uni_course_cpp::Graph::VertexId vertex_id,
+    uni_course_cpp::Span<uni_course_cpp::Graph::VertexId> vertices_ids) {
+  if (vertices_ids.empty()) {
+    return std::nullopt;
+  }
+  for (int i = 0; i < kMaxYellowRejectionsCount; ++i) {
+    const auto target_vertex_id = get_random_vertex_id(stream, vertices_ids);
+    if (!graph.has_edge(vertex_id, target_vertex_id)) {
+      return target_vertex_id;
+    }
+  }
+  const auto unconnected_vertices_ids =
+      get_unconnected_vertices_ids(graph, vertex_id, vertices_ids);
+  if (unconnected_vertices_ids.empty()) {
+    return std::nullopt;
+  }
+  return get_random_vertex_id(stream, unconnected_vertices_ids);
+}
+
+// The color passes only read the graph and return the edges to add, so every
+// chunk of every layer is generated on its own and they are all committed
+// in a fixed order afterwards.
+using VertexIdsPairs = std::vector<uni_course_cpp::Graph::VertexIdsPair>;
+
+template <typename GraphView>
+void generate_green_edges(
+    const GraphView& /*graph*/,
+    uni_course_cpp::RandomStream& stream,
+    uni_course_cpp::Graph::Depth /*depth*/,
+    uni_course_cpp::Span<uni_course_cpp::Graph::VertexId> vertices_ids,
+    VertexIdsPairs& edges) {
+  uni_course_cpp::sampling::for_each_success(
+      stream, vertices_ids.size(),
+      uni_course_cpp::config::kGreenEdgesProbability,
+      [&vertices_ids, &edges](std::size_t index) {
+        edges.emplace_back(vertices_ids[index], vertices_ids[index]);
+      });
+}
+
+template <typename GraphView>
+void generate_yellow_edges(
+    const GraphView& graph,
+    uni_course_cpp::RandomStream& stream,
+    uni_course_cpp::Graph::Depth depth,
+    uni_course_cpp::Span<uni_course_cpp::Graph::VertexId> vertices_ids,
+    VertexIdsPairs& edges) {
+  const float probability = get_yellow_edge_probability(graph.depth(), depth);
+  const auto target_vertices_ids = uni_course_cpp::Span<
+      uni_course_cpp::Graph::VertexId>(
+      graph.vertices_at_depth(depth + uni_course_cpp::kYellowEdgeDepth));
+  uni_course_cpp::sampling::for_each_success(
+      stream, vertices_ids.size(), probability,
+      [&graph, &stream, &vertices_ids, &target_vertices_ids,
+       &edges](std::size_t index) {
+        const auto vertex_id = vertices_ids[index];
+        const auto target_vertex_id = get_random_unconnected_vertex_id(
+            graph, stream, vertex_id, target_vertices_ids);
+        if (target_vertex_id.has_value()) {
+          edges.emplace_back(vertex_id, target_vertex_id.value());
         }
       });
 }
 
-void generate_yellow_edges(uni_course_cpp::Graph& graph,
-                           std::mutex& mutex_for_graph) {
-  for (auto depth = uni_course_cpp::kDefaultDepth; depth < graph.depth();
-       ++depth) {
-    const float probability = (depth - 1) / (graph.depth() - 2.f);
-    std::for_each(
-        graph.vertices_at_depth(depth).cbegin(),
-        graph.vertices_at_depth(depth).cend(),
-        [&graph, &mutex_for_graph, probability, depth](const auto vertex_id) {
-          if (check_probability(probability)) {
-            const auto unconnected_vertices_ids = get_unconnected_vertices_ids(
-                graph, vertex_id,
-                graph.vertices_at_depth(depth +
-                                        uni_course_cpp::kYellowEdgeDepth));
-            if (!unconnected_vertices_ids.empty()) {
-              const std::lock_guard lock(mutex_for_graph);
-              graph.add_edge(vertex_id,
-                             get_random_vertex_id(unconnected_vertices_ids));
-            }
-          }
-        });
+template <typename GraphView>
+void generate_red_edges(
+    const GraphView& graph,
+    uni_course_cpp::RandomStream& stream,
+    uni_course_cpp::Graph::Depth depth,
+    uni_course_cpp::Span<uni_course_cpp::Graph::VertexId> vertices_ids,
+    VertexIdsPairs& edges) {
+  const auto target_vertices_ids = uni_course_cpp::Span<
+      uni_course_cpp::Graph::VertexId>(
+      graph.vertices_at_depth(depth + uni_course_cpp::kRedEdgeDepth));
+  if (target_vertices_ids.empty()) {
+    return;
   }
+  uni_course_cpp::sampling::for_each_success(
+      stream, vertices_ids.size(),
+      uni_course_cpp::config::kRedEdgesProbability,
+      [&stream, &vertices_ids, &target_vertices_ids,
+       &edges](std::size_t index) {
+        edges.emplace_back(vertices_ids[index],
+                           get_random_vertex_id(stream, target_vertices_ids));
+      });
 }
 
-void generate_red_edges(uni_course_cpp::Graph& graph,
-                        std::mutex& mutex_for_graph) {
-  for (auto depth = uni_course_cpp::kDefaultDepth; depth < graph.depth() - 1;
-       ++depth) {
-    const std::lock_guard lock(mutex_for_graph);
-    std::for_each(
-        graph.vertices_at_depth(depth).cbegin(),
-        graph.vertices_at_depth(depth).cend(),
-        [&graph, &mutex_for_graph, depth](const auto vertex_id) {
-          if (check_probability(uni_course_cpp::config::kRedEdgesProbability) &&
-              !graph.vertices_at_depth(depth + uni_course_cpp::kRedEdgeDepth)
-                   .empty()) {
-            graph.add_edge(vertex_id,
-                           get_random_vertex_id(graph.vertices_at_depth(
-                               depth + uni_course_cpp::kRedEdgeDepth)));
-          }
-        });
+template <typename GraphView>
+struct ColorPass {
+  using GenerateChunk =
+      void (*)(const GraphView& graph,
+               uni_course_cpp::RandomStream& stream,
+               uni_course_cpp::Graph::Depth depth,
+               uni_course_cpp::Span<uni_course_cpp::Graph::VertexId>
+                   vertices_ids,
+               VertexIdsPairs& edges);
+
+  uni_course_cpp::Graph::Edge::Color color =
+      uni_course_cpp::Graph::Edge::Color::Green;
+  StreamKind stream_kind = StreamKind::Green;
+  // How many layers down the edges of the color go.
+  uni_course_cpp::Graph::Depth reach = 0;
+  // Layers from kDefaultDepth up to this one start edges of the color.
+  uni_course_cpp::Graph::Depth last_depth = 0;
+  GenerateChunk generate_chunk = nullptr;
+};
+
+template <typename GraphView>
+std::array<ColorPass<GraphView>, 3> get_color_passes(
+    uni_course_cpp::Graph::Depth depth) {
+  using Color = uni_course_cpp::Graph::Edge::Color;
+  using uni_course_cpp::kRedEdgeDepth;
+  using uni_course_cpp::kYellowEdgeDepth;
+  return {{{Color::Green, StreamKind::Green, 0, depth,
+            generate_green_edges<GraphView>},
+           {Color::Yellow, StreamKind::Yellow, kYellowEdgeDepth,
+            depth - kYellowEdgeDepth, generate_yellow_edges<GraphView>},
+           {Color::Red, StreamKind::Red, kRedEdgeDepth, depth - kRedEdgeDepth,
+            generate_red_edges<GraphView>}}};
+}
+
+// Splits a layer into chunks, each generated by a task of its own into a new
+// buffer at the end of `chunks_edges`. The streams depend only on the seed,
+// the pass, the layer and the chunk.
+template <typename GraphView>
+void submit_color_layer(uni_course_cpp::ThreadPool& thread_pool,
+                        uni_course_cpp::ThreadPool::TaskGroup& task_group,
+                        const GraphView& graph,
+                        const ColorPass<GraphView>& color_pass,
+                        uni_course_cpp::Graph::Depth layer_depth,
+                        std::uint64_t seed,
+                        std::deque<VertexIdsPairs>& chunks_edges) {
+  using uni_course_cpp::Graph;
+  using uni_course_cpp::RandomStream;
+  using uni_course_cpp::Span;
+
+  const auto layer_vertices_ids =
+      Span<Graph::VertexId>(graph.vertices_at_depth(layer_depth));
+  const auto layer_seed = RandomStream::derive_seed(seed, layer_depth);
+  for (std::size_t begin = 0, chunk = 0; begin < layer_vertices_ids.size();
+       begin += kLayerChunkSize, ++chunk) {
+    const auto chunk_vertices_ids = Span<Graph::VertexId>(
+        layer_vertices_ids.data() + begin,
+        std::min<std::size_t>(kLayerChunkSize,
+                              layer_vertices_ids.size() - begin));
+    auto& chunk_edges = chunks_edges.emplace_back();
+    thread_pool.submit(task_group, [&graph, &color_pass, &chunk_edges,
+                                    chunk_vertices_ids, layer_depth,
+                                    layer_seed, chunk]() {
+      auto stream = RandomStream(
+          layer_seed, get_stream_id(color_pass.stream_kind, chunk));
+      color_pass.generate_chunk(graph, stream, layer_depth, chunk_vertices_ids,
+                                chunk_edges);
+    });
+  }
+}
+
+// Appends the vertices of a grey tree and the edges from their parents, the
+// i-th new vertex being the child of parent_vertex_ids[i].
+void add_grey_edges(
+    uni_course_cpp::Graph& graph,
+    const std::vector<uni_course_cpp::Graph::VertexId>& parent_vertex_ids) {
+  using uni_course_cpp::Graph;
+  const auto first_vertex_id = graph.add_vertices(parent_vertex_ids.size());
+  auto grey_edges = VertexIdsPairs(parent_vertex_ids.size());
+  for (std::size_t i = 0; i < parent_vertex_ids.size(); ++i) {
+    grey_edges[i] = {parent_vertex_ids[i],
+                     first_vertex_id + static_cast<Graph::VertexId>(i)};
+  }
+  graph.add_edges(grey_edges);
+}
+
+// Generates the green, yellow and red edges that end at or below
+// `first_new_depth`, i.e. every color edge the layers from there on make
+// possible, and commits them in one batch.
+void add_color_edges(uni_course_cpp::ThreadPool& thread_pool,
+                     uni_course_cpp::Graph& graph,
+                     std::uint64_t seed,
+                     uni_course_cpp::Graph::Depth first_new_depth) {
+  using uni_course_cpp::Graph;
+  using uni_course_cpp::ThreadPool;
+
+  const auto& const_graph = graph;
+  const auto color_passes = get_color_passes<Graph>(graph.depth());
+  auto chunks_edges = std::deque<VertexIdsPairs>();
+  auto task_group = ThreadPool::TaskGroup();
+  for (const auto& color_pass : color_passes) {
+    const auto first_depth = std::max(uni_course_cpp::kDefaultDepth,
+                                      first_new_depth - color_pass.reach);
+    for (auto layer_depth = first_depth; layer_depth <= color_pass.last_depth;
+         ++layer_depth) {
+      submit_color_layer(thread_pool, task_group, const_graph, color_pass,
+                         layer_depth, seed, chunks_edges);
+    }
+  }
+  thread_pool.wait(task_group);
+
+  auto edges = VertexIdsPairs();
+  std::size_t edges_count = 0;
+  for (const auto& chunk_edges : chunks_edges) {
+    edges_count += chunk_edges.size();
+  }
+  edges.reserve(edges_count);
+  for (const auto& chunk_edges : chunks_edges) {
+    edges.insert(edges.end(), chunk_edges.cbegin(), chunk_edges.cend());
   }
+  graph.add_edges(edges);
 }
+
+// The layers of a streamed graph that are still needed: a layer is complete
+// once the colors starting from it are generated, and those reach at most
+// two layers down. Layers are contiguous id ranges, and the only edges
+// between neighbouring layers at that point are the grey ones.
+class LayerWindow {
+ public:
+  using Graph = uni_course_cpp::Graph;
+
+  struct Layer {
+    Graph::VertexId end_vertex_id() const {
+      return first_vertex_id + static_cast<Graph::VertexId>(vertex_ids.size());
+    }
+
+    Graph::Depth depth = 0;
+    Graph::VertexId first_vertex_id = 0;
+    std::vector<Graph::VertexId> vertex_ids;
+    // Empty for the root layer.
+    std::vector<Graph::VertexId> parent_vertex_ids;
+    // (index in the layer, edge id) in the order the edges were added.
+    std::vector<std::pair<Graph::VertexId, Graph::EdgeId>> vertex_edge_ids;
+  };
+
+  explicit LayerWindow(Graph::Depth graph_depth) : graph_depth_(graph_depth) {}
+
+  Graph::Depth depth() const { return graph_depth_; }
+
+  uni_course_cpp::Span<Graph::VertexId> vertices_at_depth(
+      Graph::Depth depth) const {
+    for (const auto& layer : layers_) {
+      if (layer.depth == depth) {
+        return layer.vertex_ids;
+      }
+    }
+    return {};
+  }
+
+  bool has_edge(Graph::VertexId first_vertex_id,
+                Graph::VertexId second_vertex_id) const {
+    return get_parent_vertex_id(first_vertex_id) == second_vertex_id ||
+           get_parent_vertex_id(second_vertex_id) == first_vertex_id;
+  }
+
+  bool empty() const { return layers_.empty(); }
+  const Layer& front() const { return layers_.front(); }
+  const Layer& back() const { return layers_.back(); }
+
+  const Layer& add_layer(Graph::Depth depth,
+                         Graph::VertexId first_vertex_id,
+                         std::vector<Graph::VertexId>&& parent_vertex_ids,
+                         std::size_t vertices_count) {
+    auto& layer = layers_.emplace_back();
+    layer.depth = depth;
+    layer.first_vertex_id = first_vertex_id;
+    layer.vertex_ids.resize(vertices_count);
+    std::iota(layer.vertex_ids.begin(), layer.vertex_ids.end(),
+              first_vertex_id);
+    layer.parent_vertex_ids = std::move(parent_vertex_ids);
+    return layer;
+  }
+
+  void add_edge_id(Graph::VertexId vertex_id, Graph::EdgeId edge_id) {
+    auto& layer = get_layer(vertex_id);
+    layer.vertex_edge_ids.emplace_back(vertex_id - layer.first_vertex_id,
+                                       edge_id);
+  }
+
+  // Passes every vertex of the front layer with its edge ids, in id order,
+  // to `callback` and drops the layer.
+  template <typename Callback>
+  void pop_front(const Callback& callback) {
+    auto& layer = layers_.front();
+    // Counting sort by vertex keeps the edge ids of every vertex ascending.
+    auto offsets = std::vector<std::size_t>(layer.vertex_ids.size() + 1, 0);
+    for (const auto& [index, edge_id] : layer.vertex_edge_ids) {
+      ++offsets[index + 1];
+    }
+    std::partial_sum(offsets.cbegin(), offsets.cend(), offsets.begin());
+    auto edge_ids = std::vector<Graph::EdgeId>(layer.vertex_edge_ids.size());
+    auto positions = offsets;
+    for (const auto& [index, edge_id] : layer.vertex_edge_ids) {
+      edge_ids[positions[index]++] = edge_id;
+    }
+    for (std::size_t index = 0; index < layer.vertex_ids.size(); ++index) {
+      callback(layer.vertex_ids[index], layer.depth,
+               uni_course_cpp::Span<Graph::EdgeId>(
+                   edge_ids.data() + offsets[index],
+                   offsets[index + 1] - offsets[index]));
+    }
+    layers_.pop_front();
+  }
+
+ private:
+  // Index of the layer holding the vertex, or the number of layers.
+  std::size_t find_layer_index(Graph::VertexId vertex_id) const {
+    std::size_t index = 0;
+    while (index < layers_.size() &&
+           (vertex_id < layers_[index].first_vertex_id ||
+            vertex_id >= layers_[index].end_vertex_id())) {
+      ++index;
+    }
+    return index;
+  }
+
+  Layer& get_layer(Graph::VertexId vertex_id) {
+    const auto index = find_layer_index(vertex_id);
+    assert(index < layers_.size());
+    return layers_[index];
+  }
+
+  Graph::VertexId get_parent_vertex_id(Graph::VertexId vertex_id) const {
+    const auto index = find_layer_index(vertex_id);
+    if (index == layers_.size() || layers_[index].parent_vertex_ids.empty()) {
+      return -1;
+    }
+    const auto& layer = layers_[index];
+    return layer.parent_vertex_ids[vertex_id - layer.first_vertex_id];
+  }
+
+  Graph::Depth graph_depth_ = 0;
+  std::deque<Layer> layers_;
+};
 }  // namespace
 
 namespace uni_course_cpp {
+GraphGenerator::SizeEstimate GraphGenerator::estimate_size() const {
+  auto estimate = SizeEstimate();
+  const auto depth = params_.get_depth();
+  if (depth == 0)
+    return estimate;
+
+  // Expected and maximal vertex counts of the current layer, starting from
+  // the root. Each of the new_vertices_count root jobs runs its own
+  // new_vertices_count trials on the root, so the root gets their product.
+  double expected_layer_count = 1;
+  double max_layer_count = 1;
+  double expected_yellow_edges_count = 0;
+  double expected_red_edges_count = 0;
+  for (auto layer_depth = kDefaultDepth; layer_depth <= depth; ++layer_depth) {
+    estimate.expected_vertices_count += expected_layer_count;
+    estimate.max_vertices_count += max_layer_count;
+    if (layer_depth < depth && depth > 2) {
+      expected_yellow_edges_count +=
+          expected_layer_count *
+          get_yellow_edge_probability(depth, layer_depth);
+    }
+    if (layer_depth < depth - 1) {
+      expected_red_edges_count +=
+          expected_layer_count * config::kRedEdgesProbability;
+    }
+
+    const double trials_count =
+        layer_depth == kDefaultDepth
+            ? params_.new_vertices_count() * params_.new_vertices_count()
+            : params_.new_vertices_count();
+    expected_layer_count *=
+        trials_count * get_grey_edge_probability(depth, layer_depth);
+    max_layer_count *= trials_count;
+  }
+
+  // A vertex starts at most one green, one yellow and one red edge and is
+  // the target of exactly one grey edge, the root excepted.
+  const auto expected_grey_edges_count = estimate.expected_vertices_count - 1;
+  const auto expected_green_edges_count =
+      estimate.expected_vertices_count * config::kGreenEdgesProbability;
+  estimate.expected_edges_count =
+      expected_grey_edges_count + expected_green_edges_count +
+      expected_yellow_edges_count + expected_red_edges_count;
+  estimate.max_edges_count = 4 * estimate.max_vertices_count - 1;
+  return estimate;
+}
+
 Graph GraphGenerator::generate() const {
   auto graph = Graph();
   if (params_.get_depth() == 0)
     return graph;
-  generate_grey_edges(graph, graph.add_vertex());
-
-  std::mutex mutex_for_graph;
-  std::thread green_thread(generate_green_edges, std::ref(graph),
-                           std::ref(mutex_for_graph));
-  std::thread yellow_thread(generate_yellow_edges, std::ref(graph),
-                            std::ref(mutex_for_graph));
-  std::thread red_thread(generate_red_edges, std::ref(graph),
-                         std::ref(mutex_for_graph));
-
-  green_thread.join();
-  yellow_thread.join();
-  red_thread.join();
+
+  const auto estimate = estimate_size();
+  const auto reserved_vertices_count =
+      std::min(estimate.max_vertices_count,
+               estimate.expected_vertices_count * kReserveFactor);
+  const auto reserved_edges_count =
+      std::min(estimate.max_edges_count,
+               estimate.expected_edges_count * kReserveFactor);
+  graph.reserve(static_cast<std::size_t>(reserved_vertices_count),
+                static_cast<std::size_t>(reserved_edges_count));
+  auto& thread_pool = ThreadPool::get_thread_pool();
+  generate_grey_edges(thread_pool, graph, graph.add_vertex());
+
+  add_color_edges(thread_pool, graph, params_.seed(), kDefaultDepth);
   return graph;
 }
 
+void GraphGenerator::run_grey_task(GreyTask& task,
+                                   const GreyTaskContext& context,
+                                   Graph::Depth root_vertex_depth) const {
+  auto stream = RandomStream(task.seed, get_stream_id(StreamKind::Grey, 0));
+  generate_grey_branch(task, context, stream, GreyTask::kRootLocalId,
+                       root_vertex_depth);
+}
+
 void GraphGenerator::generate_grey_branch(
-    Graph& graph,
-    std::mutex& mutex_for_graph,
-    Graph::VertexId parent_vertex_id,
+    GreyTask& task,
+    const GreyTaskContext& context,
+    RandomStream& stream,
+    Graph::VertexId parent_local_id,
     Graph::Depth parent_vertex_depth) const {
   if (parent_vertex_depth >= params_.get_depth())
     return;
   const float probability =
-      (params_.get_depth() - parent_vertex_depth) / (params_.get_depth() - 1.f);
-  for (int i = 0; i < params_.new_vertices_count(); ++i) {
-    if (check_probability(probability)) {
-      const auto child_vertex_id = [&graph, &mutex_for_graph,
-                                    parent_vertex_id]() {
-        const std::lock_guard lock(mutex_for_graph);
-        const auto child_vertex_id = graph.add_vertex();
-        graph.add_edge(parent_vertex_id, child_vertex_id);
-        return child_vertex_id;
-      }();
-      generate_grey_branch(graph, mutex_for_graph, child_vertex_id,
-                           parent_vertex_depth + 1);
+      get_grey_edge_probability(params_.get_depth(), parent_vertex_depth);
+  // Only the number of children matters, so it is drawn at once instead of
+  // running a trial per potential child.
+  const auto children_count =
+      sampling::binomial(stream, params_.new_vertices_count(), probability);
+  const auto child_depth = parent_vertex_depth + 1;
+  for (int i = 0; i < children_count; ++i) {
+    const auto child_local_id =
+        static_cast<Graph::VertexId>(task.parent_local_ids.size());
+    task.parent_local_ids.push_back(parent_local_id);
+    if (child_depth > context.max_spawn_depth) {
+      generate_grey_branch(task, context, stream, child_local_id, child_depth);
+      continue;
     }
+    // The split depends only on the params and the subtask stream only on
+    // its path from the root, so the tree does not depend on the schedule.
+    auto& subtask = task.subtasks.emplace_back(
+        child_local_id,
+        RandomStream::derive_seed(task.seed, task.subtasks.size()));
+    context.thread_pool.submit(
+        context.task_group, [this, &subtask, &context, child_depth]() {
+          run_grey_task(subtask, context, child_depth);
+        });
   }
 }
 
-void GraphGenerator::generate_grey_edges(Graph& graph,
-                                         Graph::VertexId root_vertex_id) const {
-  if (params_.get_depth() <= kDefaultDepth)
+void GraphGenerator::deepen(Graph& graph) const {
+  if (params_.get_depth() == 0)
     return;
+  const auto first_new_depth =
+      graph.vertices().empty() ? kDefaultDepth : graph.depth() + 1;
+  if (graph.vertices().empty()) {
+    graph.add_vertex();
+  }
 
-  using JobCallback = std::function<void()>;
-  auto jobs = std::list<JobCallback>();
-  std::mutex mutex_for_graph;
-  std::mutex mutex_for_jobs;
-  std::atomic<int> number_of_jobs = params_.new_vertices_count();
+  auto& thread_pool = ThreadPool::get_thread_pool();
+  const auto frontier_depth = graph.depth();
+  const auto parent_vertex_ids = generate_grey_layers(
+      thread_pool, graph.vertices_at_depth(frontier_depth), frontier_depth,
+      static_cast<Graph::VertexId>(graph.vertices().size()));
+  add_grey_edges(graph, parent_vertex_ids);
+  if (graph.depth() < first_new_depth)
+    return;
 
-  for (int i = 0; i < number_of_jobs; ++i) {
-    jobs.push_back([&graph, &mutex_for_graph, root_vertex_id, this]() {
-      generate_grey_branch(graph, mutex_for_graph, root_vertex_id,
-                           kDefaultDepth);
-    });
+  add_color_edges(thread_pool, graph, params_.seed(), first_new_depth);
+}
+
+Graph::Stats GraphGenerator::generate_stats() const {
+  auto stats = Graph::Stats();
+  const auto depth = params_.get_depth();
+  if (depth == 0)
+    return stats;
+
+  auto stream =
+      RandomStream(params_.seed(), get_stream_id(StreamKind::Stats, 0));
+  const auto new_vertices_count =
+      static_cast<std::int64_t>(params_.new_vertices_count());
+  auto& depth_vertices_counts = stats.depth_vertices_counts;
+  depth_vertices_counts = {0, 1};
+  // The children of a layer are a sum of binomials of the same probability,
+  // so they are drawn as a single binomial over all trials of the layer.
+  for (auto layer_depth = kDefaultDepth; layer_depth < depth; ++layer_depth) {
+    const auto trials_count =
+        layer_depth == kDefaultDepth
+            ? new_vertices_count * new_vertices_count
+            : new_vertices_count * static_cast<std::int64_t>(
+                                       depth_vertices_counts[layer_depth]);
+    const auto children_count = sampling::binomial(
+        stream, trials_count, get_grey_edge_probability(depth, layer_depth));
+    if (children_count == 0)
+      break;
+    depth_vertices_counts.push_back(children_count);
+  }
+
+  const auto graph_depth = stats.depth();
+  auto& color_edges_counts = stats.color_edges_counts;
+  for (auto layer_depth = kDefaultDepth; layer_depth <= graph_depth;
+       ++layer_depth) {
+    const auto layer_count =
+        static_cast<std::int64_t>(depth_vertices_counts[layer_depth]);
+    stats.vertices_count += layer_count;
+    color_edges_counts[static_cast<int>(Graph::Edge::Color::Green)] +=
+        sampling::binomial(stream, layer_count,
+                           config::kGreenEdgesProbability);
+    if (layer_depth + kYellowEdgeDepth <= graph_depth && layer_count > 1) {
+      color_edges_counts[static_cast<int>(Graph::Edge::Color::Yellow)] +=
+          sampling::binomial(
+              stream, layer_count,
+              get_yellow_edge_probability(graph_depth, layer_depth));
+    }
+    if (layer_depth + kRedEdgeDepth <= graph_depth) {
+      color_edges_counts[static_cast<int>(Graph::Edge::Color::Red)] +=
+          sampling::binomial(stream, layer_count,
+                             config::kRedEdgesProbability);
+    }
+  }
+  color_edges_counts[static_cast<int>(Graph::Edge::Color::Grey)] =
+      stats.vertices_count - 1;
+  for (const auto color_edges_count : color_edges_counts) {
+    stats.edges_count += color_edges_count;
+  }
+  return stats;
+}
+
+void GraphGenerator::generate(GraphSink& sink) const {
+  const auto depth = params_.get_depth();
+  if (depth == 0) {
+    sink.finish(0);
+    return;
   }
 
-  std::atomic<bool> should_terminate = false;
-  const auto worker = [&should_terminate, &mutex_for_jobs, &jobs,
-                       &number_of_jobs]() {
-    while (true) {
-      if (should_terminate) {
-        return;
+  auto& thread_pool = ThreadPool::get_thread_pool();
+  auto window = LayerWindow(depth);
+  const auto color_passes = get_color_passes<LayerWindow>(depth);
+  Graph::EdgeId next_edge_id = 0;
+  const auto add_edge = [&sink, &window, &next_edge_id](
+                            Graph::VertexId from_vertex_id,
+                            Graph::VertexId to_vertex_id,
+                            Graph::Edge::Color color) {
+    const auto edge_id = next_edge_id++;
+    sink.add_edge(Graph::Edge(edge_id, from_vertex_id, to_vertex_id, color));
+    window.add_edge_id(from_vertex_id, edge_id);
+    if (from_vertex_id != to_vertex_id) {
+      window.add_edge_id(to_vertex_id, edge_id);
+    }
+  };
+
+  window.add_layer(kDefaultDepth, 0, {}, 1);
+  auto graph_depth = kDefaultDepth;
+  bool is_grey_tree_complete = false;
+  while (!window.empty()) {
+    if (!is_grey_tree_complete) {
+      const auto& deepest_layer = window.back();
+      auto parent_vertex_ids = std::vector<Graph::VertexId>();
+      if (deepest_layer.depth < depth) {
+        generate_grey_layer(thread_pool, deepest_layer.depth,
+                            deepest_layer.vertex_ids, parent_vertex_ids);
       }
-      const auto job_optional =
-          [&jobs, &mutex_for_jobs]() -> std::optional<JobCallback> {
-        const std::lock_guard lock(mutex_for_jobs);
-        if (!jobs.empty()) {
-          const auto item = jobs.back();
-          jobs.pop_back();
-          return item;
+      if (parent_vertex_ids.empty()) {
+        is_grey_tree_complete = true;
+      } else {
+        const auto vertices_count = parent_vertex_ids.size();
+        const auto& layer = window.add_layer(
+            deepest_layer.depth + 1, deepest_layer.end_vertex_id(),
+            std::move(parent_vertex_ids), vertices_count);
+        graph_depth = layer.depth;
+        for (std::size_t i = 0; i < vertices_count; ++i) {
+          add_edge(layer.parent_vertex_ids[i], layer.vertex_ids[i],
+                   Graph::Edge::Color::Grey);
         }
-        return std::nullopt;
-      }();
-      if (job_optional.has_value()) {
-        --number_of_jobs;
-        const auto& job = job_optional.value();
-        job();
       }
     }
+    if (!is_grey_tree_complete &&
+        window.front().depth + kRedEdgeDepth > window.back().depth) {
+      continue;
+    }
+
+    // The front layer now has its children and the layers its colors reach.
+    const auto layer_depth = window.front().depth;
+    auto chunks_edges = std::deque<VertexIdsPairs>();
+    auto pass_chunks_ends = std::array<std::size_t, color_passes.size()>();
+    auto task_group = ThreadPool::TaskGroup();
+    for (std::size_t i = 0; i < color_passes.size(); ++i) {
+      if (layer_depth <= color_passes[i].last_depth) {
+        submit_color_layer(thread_pool, task_group, window, color_passes[i],
+                           layer_depth, params_.seed(), chunks_edges);
+      }
+      pass_chunks_ends[i] = chunks_edges.size();
+    }
+    thread_pool.wait(task_group);
+
+    std::size_t chunk = 0;
+    for (std::size_t i = 0; i < color_passes.size(); ++i) {
+      for (; chunk < pass_chunks_ends[i]; ++chunk) {
+        for (const auto& [from_vertex_id, to_vertex_id] :
+             chunks_edges[chunk]) {
+          add_edge(from_vertex_id, to_vertex_id, color_passes[i].color);
+        }
+      }
+    }
+    window.pop_front([&sink](Graph::VertexId vertex_id,
+                             Graph::Depth vertex_depth,
+                             Span<Graph::EdgeId> edge_ids) {
+      sink.add_vertex(Graph::Vertex(vertex_id), vertex_depth, edge_ids);
+    });
+  }
+  sink.finish(graph_depth);
+}
+
+std::vector<Graph::VertexId> GraphGenerator::generate_grey_subtrees(
+    ThreadPool& thread_pool,
+    Graph::VertexId root_vertex_id) const {
+  const auto depth = params_.get_depth();
+  const auto new_vertices_count = params_.new_vertices_count();
+
+  // Expected subtree sizes shrink with depth, so the branches worth a task
+  // of their own are exactly those rooted above some depth.
+  auto max_spawn_depth = kDefaultDepth;
+  double expected_subtree_size = 1;
+  for (auto vertex_depth = depth - 1; vertex_depth > kDefaultDepth;
+       --vertex_depth) {
+    expected_subtree_size =
+        1 + new_vertices_count *
+                get_grey_edge_probability(depth, vertex_depth) *
+                expected_subtree_size;
+    if (expected_subtree_size >= kMinGreyTaskSize) {
+      max_spawn_depth = vertex_depth;
+      break;
+    }
+  }
+
+  // The root tasks are new_vertices_count branches of the root, each
+  // running its own new_vertices_count trials.
+  auto task_group = ThreadPool::TaskGroup();
+  const auto context =
+      GreyTaskContext{thread_pool, task_group, max_spawn_depth};
+  auto root_task = GreyTask(GreyTask::kRootLocalId, params_.seed());
+  for (int i = 0; i < new_vertices_count; ++i) {
+    auto& subtask = root_task.subtasks.emplace_back(
+        GreyTask::kRootLocalId, RandomStream::derive_seed(params_.seed(), i));
+    thread_pool.submit(task_group, [this, &subtask, &context]() {
+      run_grey_task(subtask, context, kDefaultDepth);
+    });
+  }
+  thread_pool.wait(task_group);
+
+  // Every task gets a contiguous range of global ids in pre-order of the
+  // task tree. Parents precede their children inside a task, and a task
+  // follows the task holding its root, so they do in the merged order too.
+  struct TaskPlacement {
+    GreyTask* task = nullptr;
+    Graph::VertexId root_vertex_id = 0;
+    Graph::VertexId offset = 0;
+  };
+  const auto first_vertex_id = root_vertex_id + 1;
+  auto placements = std::vector<TaskPlacement>();
+  Graph::VertexId vertices_count = 0;
+  const auto place_task = [&placements, &vertices_count, first_vertex_id](
+                              const auto& place_task, GreyTask& task,
+                              Graph::VertexId task_root_vertex_id) -> void {
+    const auto offset = vertices_count;
+    placements.push_back({&task, task_root_vertex_id, offset});
+    vertices_count += task.parent_local_ids.size();
+    for (auto& subtask : task.subtasks) {
+      place_task(place_task, subtask,
+                 subtask.root_local_id == GreyTask::kRootLocalId
+                     ? task_root_vertex_id
+                     : first_vertex_id + offset + subtask.root_local_id);
+    }
   };
+  place_task(place_task, root_task, root_vertex_id);
 
-  const auto threads_count =
-      std::min(kMaxThreadsCount, params_.new_vertices_count());
-  auto threads = std::vector<std::thread>();
-  threads.reserve(threads_count);
+  auto parent_vertex_ids = std::vector<Graph::VertexId>(vertices_count);
+  for (const auto& placement : placements) {
+    thread_pool.submit(task_group, [&placement, &parent_vertex_ids,
+                                    first_vertex_id]() {
+      const auto& parent_local_ids = placement.task->parent_local_ids;
+      const auto task_first_vertex_id = first_vertex_id + placement.offset;
+      for (std::size_t local_id = 0; local_id < parent_local_ids.size();
+           ++local_id) {
+        const auto parent_local_id = parent_local_ids[local_id];
+        parent_vertex_ids[placement.offset + local_id] =
+            parent_local_id == GreyTask::kRootLocalId
+                ? placement.root_vertex_id
+                : task_first_vertex_id + parent_local_id;
+      }
+    });
+  }
+  thread_pool.wait(task_group);
+  return parent_vertex_ids;
+}
+
+void GraphGenerator::generate_grey_layer(
+    ThreadPool& thread_pool,
+    Graph::Depth depth,
+    Span<Graph::VertexId> frontier_vertex_ids,
+    std::vector<Graph::VertexId>& parent_vertex_ids) const {
+  const auto frontier_size =
+      static_cast<Graph::VertexId>(frontier_vertex_ids.size());
+  const auto chunks_count =
+      (frontier_size + kLayerChunkSize - 1) / kLayerChunkSize;
+  // The depth-first mode runs new_vertices_count root jobs of
+  // new_vertices_count trials each, so the root does the same here.
+  const auto trials_count =
+      depth == kDefaultDepth
+          ? params_.new_vertices_count() * params_.new_vertices_count()
+          : params_.new_vertices_count();
+  const float probability =
+      get_grey_edge_probability(params_.get_depth(), depth);
+  const auto layer_seed = RandomStream::derive_seed(params_.seed(), depth);
+  auto task_group = ThreadPool::TaskGroup();
 
-  for (int i = 0; i < threads_count; ++i) {
-    threads.emplace_back(worker);
+  // First pass: every chunk draws the children counts of its vertices.
+  auto children_counts = std::vector<int>(frontier_size);
+  auto chunk_offsets = std::vector<Graph::VertexId>(chunks_count + 1, 0);
+  for (int chunk = 0; chunk < chunks_count; ++chunk) {
+    thread_pool.submit(task_group, [&children_counts, &chunk_offsets, chunk,
+                                    frontier_size, trials_count, probability,
+                                    layer_seed]() {
+      auto stream = RandomStream(
+          layer_seed, get_stream_id(StreamKind::GreyLayer, chunk));
+      const auto chunk_end =
+          std::min(frontier_size, (chunk + 1) * kLayerChunkSize);
+      Graph::VertexId chunk_children_count = 0;
+      for (auto i = chunk * kLayerChunkSize; i < chunk_end; ++i) {
+        children_counts[i] =
+            sampling::binomial(stream, trials_count, probability);
+        chunk_children_count += children_counts[i];
+      }
+      chunk_offsets[chunk + 1] = chunk_children_count;
+    });
   }
+  thread_pool.wait(task_group);
 
-  while (number_of_jobs) {
+  // Second pass: the prefix sums give every chunk its own range of the next
+  // layer, which it fills without synchronization.
+  std::partial_sum(chunk_offsets.cbegin(), chunk_offsets.cend(),
+                   chunk_offsets.begin());
+  const auto layer_offset = parent_vertex_ids.size();
+  parent_vertex_ids.resize(layer_offset + chunk_offsets.back());
+  for (int chunk = 0; chunk < chunks_count; ++chunk) {
+    const auto chunk_position = layer_offset + chunk_offsets[chunk];
+    thread_pool.submit(task_group, [&children_counts, &parent_vertex_ids,
+                                    chunk, frontier_vertex_ids, frontier_size,
+                                    position = chunk_position]() mutable {
+      const auto chunk_end =
+          std::min(frontier_size, (chunk + 1) * kLayerChunkSize);
+      for (auto i = chunk * kLayerChunkSize; i < chunk_end; ++i) {
+        std::fill_n(parent_vertex_ids.begin() + position, children_counts[i],
+                    frontier_vertex_ids[i]);
+        position += children_counts[i];
+      }
+    });
   }
+  thread_pool.wait(task_group);
+}
 
-  should_terminate = true;
-  for (auto& thread : threads) {
-    thread.join();
+std::vector<Graph::VertexId> GraphGenerator::generate_grey_layers(
+    ThreadPool& thread_pool,
+    Span<Graph::VertexId> frontier_vertex_ids,
+    Graph::Depth frontier_depth,
+    Graph::VertexId first_vertex_id) const {
+  auto parent_vertex_ids = std::vector<Graph::VertexId>();
+  // Ids are given out layer by layer, so every new layer is a contiguous
+  // range following the previous one.
+  auto frontier = std::vector<Graph::VertexId>(frontier_vertex_ids.begin(),
+                                               frontier_vertex_ids.end());
+  for (auto depth = frontier_depth;
+       depth < params_.get_depth() && !frontier.empty(); ++depth) {
+    const auto layer_offset = parent_vertex_ids.size();
+    generate_grey_layer(thread_pool, depth, frontier, parent_vertex_ids);
+    frontier.resize(parent_vertex_ids.size() - layer_offset);
+    std::iota(frontier.begin(), frontier.end(),
+              first_vertex_id + static_cast<Graph::VertexId>(layer_offset));
   }
+  return parent_vertex_ids;
+}
+
+void GraphGenerator::generate_grey_edges(ThreadPool& thread_pool,
+                                         Graph& graph,
+                                         Graph::VertexId root_vertex_id) const {
+  if (params_.get_depth() <= kDefaultDepth)
+    return;
+
+  const auto parent_vertex_ids =
+      params_.grey_tree_mode() == GreyTreeMode::LevelSynchronous
+          ? generate_grey_layers(thread_pool,
+                                 Span<Graph::VertexId>(&root_vertex_id, 1),
+                                 kDefaultDepth, root_vertex_id + 1)
+          : generate_grey_subtrees(thread_pool, root_vertex_id);
+
+  assert(graph.vertices().size() ==
+         static_cast<std::size_t>(root_vertex_id + 1));
+  add_grey_edges(graph, parent_vertex_ids);
 }
 }  // namespace uni_course_cpp
@@ -1,34 +1,140 @@
 #pragma once
-#include <mutex>
+#include <cstdint>
+#include <deque>
+#include <vector>
 #include "graph.hpp"
+#include "graph_sink.hpp"
+#include "random_stream.hpp"
+#include "span.hpp"
+#include "thread_pool.hpp"
 
 namespace uni_course_cpp {
 class GraphGenerator {
  public:
+  // How the grey tree is grown: branch by branch from the root children, or
+  // layer by layer with every layer split evenly over the threads.
+  enum class GreyTreeMode { DepthFirst, LevelSynchronous };
+
   struct Params {
    public:
-    Params(Graph::Depth depth, int new_vertices_count)
-        : depth_(depth), new_vertices_count_(new_vertices_count) {}
+    // Generators with equal params produce identical graphs, whatever the
+    // number of threads involved.
+    Params(Graph::Depth depth,
+           int new_vertices_count,
+           std::uint64_t seed = RandomStream::make_random_seed(),
+           GreyTreeMode grey_tree_mode = GreyTreeMode::LevelSynchronous)
+        : depth_(depth),
+          new_vertices_count_(new_vertices_count),
+          seed_(seed),
+          grey_tree_mode_(grey_tree_mode) {}
 
     Graph::Depth get_depth() const { return depth_; }
     int new_vertices_count() const { return new_vertices_count_; }
+    std::uint64_t seed() const { return seed_; }
+    GreyTreeMode grey_tree_mode() const { return grey_tree_mode_; }
 
    private:
     Graph::Depth depth_ = 0;
     int new_vertices_count_ = 0;
+    std::uint64_t seed_ = 0;
+    GreyTreeMode grey_tree_mode_ = GreyTreeMode::LevelSynchronous;
+  };
+
+  // Closed-form size prediction for graphs generated with the params. The
+  // counts are doubles because the upper bounds grow as
+  // new_vertices_count^depth.
+  struct SizeEstimate {
+    double expected_vertices_count = 0;
+    double expected_edges_count = 0;
+    double max_vertices_count = 0;
+    double max_edges_count = 0;
   };
 
   explicit GraphGenerator(Params&& params) : params_(std::move(params)) {}
 
+  SizeEstimate estimate_size() const;
+
   Graph generate() const;
-  void generate_grey_branch(Graph&,
-                            std::mutex&,
-                            Graph::VertexId,
-                            Graph::Depth) const;
+
+  // Grows an existing graph down to the params depth: grey layers continue
+  // from its deepest layer level-synchronously, and only the color edges
+  // reaching the new layers are added. Layers that already exist keep the
+  // probabilities they were drawn with.
+  void deepen(Graph& graph) const;
+
+  // Dry run: draws only the layer sizes and color counts, with one binomial
+  // per layer and color, and returns what print_graph reports. The counts
+  // follow the distributions of generate() but not its draws for the seed.
+  // Yellow edges are only ruled out for a layer of a single vertex, which
+  // is then adjacent to the whole next layer. Degrees are not tallied.
+  Graph::Stats generate_stats() const;
+
+  // Streaming mode: pushes the graph into the sink layer by layer and only
+  // keeps the few layers the color rules still need, so the graph size is
+  // not bounded by memory. The grey tree is always grown level-synchronously
+  // and yields the same graph as generate() up to the edge ids, which follow
+  // the emission order. The yellow probability uses the requested depth,
+  // as the final one is not known until the tree is complete.
+  void generate(GraphSink& sink) const;
 
  private:
-  void generate_grey_edges(Graph& graph, Graph::VertexId root_vertex_id) const;
+  // Grey subtree built by one task in a private buffer with task-local ids:
+  // local vertex i is the child of parent_local_ids[i], or of the task's
+  // root vertex for kRootLocalId. Large subtrees are split off into subtasks
+  // rooted at one of the task's vertices. Tasks are merged into the graph in
+  // pre-order at the end.
+  struct GreyTask {
+    static constexpr Graph::VertexId kRootLocalId = -1;
+
+    GreyTask(Graph::VertexId root_local_id, std::uint64_t seed)
+        : root_local_id(root_local_id), seed(seed) {}
+
+    // Local id of the root vertex in the task that spawned this one.
+    Graph::VertexId root_local_id = kRootLocalId;
+    std::uint64_t seed = 0;
+    std::vector<Graph::VertexId> parent_local_ids;
+    std::deque<GreyTask> subtasks;
+  };
+
+  // What every grey task shares: the pool it spawns into and the depths at
+  // which subtrees are still large enough to become tasks of their own.
+  struct GreyTaskContext {
+    ThreadPool& thread_pool;
+    ThreadPool::TaskGroup& task_group;
+    Graph::Depth max_spawn_depth = 0;
+  };
+
+  void run_grey_task(GreyTask& task,
+                     const GreyTaskContext& context,
+                     Graph::Depth root_vertex_depth) const;
+  void generate_grey_branch(GreyTask& task,
+                            const GreyTaskContext& context,
+                            RandomStream& stream,
+                            Graph::VertexId parent_local_id,
+                            Graph::Depth parent_vertex_depth) const;
+  // Appends the parents of the layer below the frontier, whose vertices lie
+  // at `depth`.
+  void generate_grey_layer(
+      ThreadPool& thread_pool,
+      Graph::Depth depth,
+      Span<Graph::VertexId> frontier_vertex_ids,
+      std::vector<Graph::VertexId>& parent_vertex_ids) const;
+  // Both return the parent of every new grey vertex, indexed by the id of
+  // the vertex minus the first new id.
+  std::vector<Graph::VertexId> generate_grey_subtrees(
+      ThreadPool& thread_pool,
+      Graph::VertexId root_vertex_id) const;
+  // Grows the layers below the frontier, numbering new vertices from
+  // first_vertex_id.
+  std::vector<Graph::VertexId> generate_grey_layers(
+      ThreadPool& thread_pool,
+      Span<Graph::VertexId> frontier_vertex_ids,
+      Graph::Depth frontier_depth,
+      Graph::VertexId first_vertex_id) const;
+  void generate_grey_edges(ThreadPool& thread_pool,
+                           Graph& graph,
+                           Graph::VertexId root_vertex_id) const;
 
-  Params params_ = Params(0, 0);
+  Params params_ = Params(0, 0, 0);
 };
 }  // namespace uni_course_cpp
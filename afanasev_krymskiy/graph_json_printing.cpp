@@ -1,13 +1,70 @@
 #include "graph_json_printing.hpp"
 #include <string>
-#include <unordered_map>
 #include <vector>
+#include "frozen_graph.hpp"
 #include "graph.hpp"
 #include "graph_printing.hpp"
+#include "span.hpp"
+
+namespace {
+template <typename GraphType>
+std::string print_graph_json(const GraphType& graph) {
+  namespace json = uni_course_cpp::printing::json;
+
+  std::string result = "{";
+
+  result += "\"depth\": ";
+  result += std::to_string(graph.depth());
+
+  result += ",";
+
+  result += "\"vertices\":[";
+  const auto& vertices = graph.vertices();
+  for (const auto& vertex : vertices) {
+    result += json::print_vertex(vertex, graph);
+    result += ",";
+  }
+  if (!vertices.empty()) {
+    result.pop_back();
+  }
+
+  result += "]";
+
+  result += ",";
+
+  result += "\"edges\":[";
+  const auto& edges = graph.edges();
+  for (const auto& edge : edges) {
+    result += json::print_edge(edge);
+    result += ",";
+  }
+  if (!edges.empty()) {
+    result.pop_back();
+  }
+
+  result += "]";
+
+  result += "}\n";
+  return result;
+}
+}  // namespace
 
 namespace uni_course_cpp {
 std::string printing::json::print_vertex(const Graph::Vertex& vertex,
                                          const Graph& graph) {
+  return print_vertex(vertex, graph.connected_edge_ids(vertex.id()),
+                      graph.vertex_depth(vertex.id()));
+}
+
+std::string printing::json::print_vertex(const Graph::Vertex& vertex,
+                                         const FrozenGraph& graph) {
+  return print_vertex(vertex, graph.connected_edge_ids(vertex.id()),
+                      graph.vertex_depth(vertex.id()));
+}
+
+std::string printing::json::print_vertex(const Graph::Vertex& vertex,
+                                         Span<Graph::EdgeId> edge_ids,
+                                         Graph::Depth depth) {
   std::string result = "{";
 
   result += "\"id\":";
@@ -16,7 +73,6 @@ std::string printing::json::print_vertex(const Graph::Vertex& vertex,
   result += ",";
 
   result += "\"edge_ids\":[";
-  const auto& edge_ids = graph.connected_edge_ids(vertex.id());
   for (const auto edge_id : edge_ids) {
     result += std::to_string(edge_id);
     result += ",";
@@ -29,7 +85,7 @@ std::string printing::json::print_vertex(const Graph::Vertex& vertex,
   result += ",";
 
   result += "\"depth\": ";
-  result += std::to_string(graph.vertex_depth(vertex.id()));
+  result += std::to_string(depth);
 
   result += "}";
   return result;
@@ -60,40 +116,10 @@ std::string printing::json::print_edge(const Graph::Edge& edge) {
 }
 
 std::string printing::json::print_graph(const Graph& graph) {
-  std::string result = "{";
-
-  result += "\"depth\": ";
-  result += std::to_string(graph.depth());
-
-  result += ",";
-
-  result += "\"vertices\":[";
-  const auto& vertices = graph.vertices();
-  for (const auto& [vertex_id, vertex] : vertices) {
-    result += print_vertex(vertex, graph);
-    result += ",";
-  }
-  if (!vertices.empty()) {
-    result.pop_back();
-  }
-
-  result += "]";
-
-  result += ",";
-
-  result += "\"edges\":[";
-  const auto& edges = graph.edges();
-  for (const auto& [edge_id, edge] : edges) {
-    result += print_edge(edge);
-    result += ",";
-  }
-  if (!edges.empty()) {
-    result.pop_back();
-  }
-
-  result += "]";
+  return print_graph_json(graph);
+}
 
-  result += "}\n";
-  return result;
+std::string printing::json::print_graph(const FrozenGraph& graph) {
+  return print_graph_json(graph);
 }
 }  // namespace uni_course_cpp
@@ -1,13 +1,21 @@
 #pragma once
 #include <string>
+#include "frozen_graph.hpp"
 #include "graph.hpp"
+#include "span.hpp"
 
 namespace uni_course_cpp {
 namespace printing {
 namespace json {
 std::string print_vertex(const Graph::Vertex& vertex, const Graph& graph);
+std::string print_vertex(const Graph::Vertex& vertex,
+                         const FrozenGraph& graph);
+std::string print_vertex(const Graph::Vertex& vertex,
+                         Span<Graph::EdgeId> edge_ids,
+                         Graph::Depth depth);
 std::string print_edge(const Graph::Edge& edge);
 std::string print_graph(const Graph& graph);
+std::string print_graph(const FrozenGraph& graph);
 }  // namespace json
 }  // namespace printing
 }  // namespace uni_course_cpp
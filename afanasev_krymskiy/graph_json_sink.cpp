@@ -0,0 +1,63 @@
+#include "graph_json_sink.hpp"
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include "graph.hpp"
+#include "graph_json_printing.hpp"
+#include "span.hpp"
+
+namespace {
+// Enough for any int depth.
+constexpr int kDepthWidth = 11;
+}  // namespace
+
+namespace uni_course_cpp {
+JsonGraphSink::JsonGraphSink(const std::string& file_name)
+    : file_(file_name),
+      edges_file_name_(file_name + ".edges"),
+      edges_file_(edges_file_name_) {
+  file_ << "{\"depth\": ";
+  depth_position_ = file_.tellp();
+  file_ << std::string(kDepthWidth, ' ') << ",\"vertices\":[";
+}
+
+JsonGraphSink::~JsonGraphSink() {
+  if (edges_file_.is_open()) {
+    edges_file_.close();
+    std::remove(edges_file_name_.c_str());
+  }
+}
+
+void JsonGraphSink::add_edge(const Graph::Edge& edge) {
+  if (has_edges_) {
+    edges_file_ << ",";
+  }
+  edges_file_ << printing::json::print_edge(edge);
+  has_edges_ = true;
+}
+
+void JsonGraphSink::add_vertex(const Graph::Vertex& vertex,
+                               Graph::Depth depth,
+                               Span<Graph::EdgeId> edge_ids) {
+  if (has_vertices_) {
+    file_ << ",";
+  }
+  file_ << printing::json::print_vertex(vertex, edge_ids, depth);
+  has_vertices_ = true;
+}
+
+void JsonGraphSink::finish(Graph::Depth depth) {
+  file_ << "],\"edges\":[";
+  edges_file_.close();
+  if (has_edges_) {
+    std::ifstream edges_file(edges_file_name_);
+    file_ << edges_file.rdbuf();
+  }
+  std::remove(edges_file_name_.c_str());
+  file_ << "]}\n";
+
+  file_.seekp(depth_position_);
+  file_ << depth;
+  file_.close();
+}
+}  // namespace uni_course_cpp
@@ -0,0 +1,34 @@
+#pragma once
+#include <fstream>
+#include <string>
+#include "graph.hpp"
+#include "graph_sink.hpp"
+#include "span.hpp"
+
+namespace uni_course_cpp {
+// Writes a streamed graph as the JSON of printing::json::print_graph.
+// Vertices go straight to the file while edges, which come first but are
+// printed last, are spilled to a side file and appended on finish. The depth
+// is only known at the end, so it is written into a blank reserved for it.
+class JsonGraphSink : public GraphSink {
+ public:
+  explicit JsonGraphSink(const std::string& file_name);
+  JsonGraphSink(const JsonGraphSink& other) = delete;
+  void operator=(const JsonGraphSink& other) = delete;
+  ~JsonGraphSink() override;
+
+  void add_edge(const Graph::Edge& edge) override;
+  void add_vertex(const Graph::Vertex& vertex,
+                  Graph::Depth depth,
+                  Span<Graph::EdgeId> edge_ids) override;
+  void finish(Graph::Depth depth) override;
+
+ private:
+  std::ofstream file_;
+  std::ofstream::pos_type depth_position_;
+  std::string edges_file_name_;
+  std::ofstream edges_file_;
+  bool has_vertices_ = false;
+  bool has_edges_ = false;
+};
+}  // namespace uni_course_cpp
@@ -1,6 +1,7 @@
 #include "graph_printing.hpp"
 #include <array>
 #include <string>
+#include "frozen_graph.hpp"
 #include "graph.hpp"
 
 namespace {
@@ -9,7 +10,7 @@ constexpr std::array<uni_course_cpp::Graph::Edge::Color, 4> kColors = {
     uni_course_cpp::Graph::Edge::Color::Green,
     uni_course_cpp::Graph::Edge::Color::Yellow,
     uni_course_cpp::Graph::Edge::Color::Red};
-}
+}  // namespace
 
 namespace uni_course_cpp {
 std::string printing::print_edge_color(Graph::Edge::Color color) {
@@ -24,26 +25,28 @@ std::string printing::print_edge_color(Graph::Edge::Color color) {
       return "green";
   }
 }
-std::string printing::print_graph(const Graph& graph) {
+std::string printing::print_graph_stats(const Graph::Stats& stats) {
   std::string result = "{\n";
 
-  result += "  depth: " + std::to_string(graph.depth()) + ",\n";
+  result += "  depth: " + std::to_string(stats.depth()) + ",\n";
 
-  result += "  vertices: {amount: " + std::to_string(graph.vertices().size()) +
+  result += "  vertices: {amount: " + std::to_string(stats.vertices_count) +
             ", distribution: [";
-  for (auto depth = kDefaultDepth; depth <= graph.depth(); ++depth) {
-    result += std::to_string(graph.vertices_at_depth(depth).size());
-    if (depth != graph.depth()) {
+  for (auto depth = kDefaultDepth; depth <= stats.depth(); ++depth) {
+    result += std::to_string(stats.depth_vertices_counts[depth]);
+    if (depth != stats.depth()) {
       result += ", ";
     }
   }
   result += "]},\n";
 
-  result += "  edges: {amount: " + std::to_string(graph.edges().size()) +
+  result += "  edges: {amount: " + std::to_string(stats.edges_count) +
             ", distribution: {";
   for (const auto color : kColors) {
-    result += printing::print_edge_color(color) + ": " +
-              std::to_string(graph.color_edge_ids(color).size()) + ", ";
+    result +=
+        printing::print_edge_color(color) + ": " +
+        std::to_string(stats.color_edges_counts[static_cast<int>(color)]) +
+        ", ";
   }
   if (!kColors.empty()) {
     result.pop_back();
@@ -54,4 +57,12 @@ std::string printing::print_graph(const Graph& graph) {
   result += "}\n";
   return result;
 }
+
+std::string printing::print_graph(const Graph& graph) {
+  return print_graph_stats(graph.stats());
+}
+
+std::string printing::print_graph(const FrozenGraph& graph) {
+  return print_graph_stats(graph.stats());
+}
 }  // namespace uni_course_cpp
@@ -1,10 +1,13 @@
 #pragma once
 #include <string>
+#include "frozen_graph.hpp"
 #include "graph.hpp"
 
 namespace uni_course_cpp {
 namespace printing {
 std::string print_edge_color(Graph::Edge::Color);
+std::string print_graph_stats(const Graph::Stats&);
 std::string print_graph(const Graph&);
+std::string print_graph(const FrozenGraph&);
 }  // namespace printing
 }  // namespace uni_course_cpp
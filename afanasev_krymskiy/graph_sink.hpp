@@ -0,0 +1,21 @@
+#pragma once
+#include "graph.hpp"
+#include "span.hpp"
+
+namespace uni_course_cpp {
+// Receiver of a graph that is produced piece by piece instead of being built
+// in memory. Vertex and edge ids are dense and start from 0.
+class GraphSink {
+ public:
+  virtual ~GraphSink() = default;
+
+  // Edges come in id order.
+  virtual void add_edge(const Graph::Edge& edge) = 0;
+  // Vertices come in id order, each after all of its edges.
+  virtual void add_vertex(const Graph::Vertex& vertex,
+                          Graph::Depth depth,
+                          Span<Graph::EdgeId> edge_ids) = 0;
+  // Called last, with the depth of the whole graph.
+  virtual void finish(Graph::Depth depth) = 0;
+};
+}  // namespace uni_course_cpp
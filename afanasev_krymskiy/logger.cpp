@@ -22,8 +22,9 @@ std::string get_current_date_time() {
 
 namespace uni_course_cpp {
 void Logger::log(const std::string& string) {
-  const auto result = get_current_date_time() + string;
+  // std::localtime shares a static buffer, so the time is taken under lock.
   const std::lock_guard lock(logger_mutex_);
+  const auto result = get_current_date_time() + string;
   std::cout << result << std::endl;
   log_ << result << std::endl;
 }
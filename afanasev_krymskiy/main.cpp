@@ -2,8 +2,13 @@
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include "bounded_queue.hpp"
 #include "config.hpp"
+#include "frozen_graph.hpp"
 #include "graph_generation_controller.hpp"
 #include "graph_generator.hpp"
 #include "graph_json_printing.hpp"
@@ -12,6 +17,32 @@
 
 namespace file_system = std::filesystem;
 
+// Finished graphs are frozen and printed by a few serializer threads, while
+// a single writer thread does the disk I/O.
+constexpr int kSerializersCount = 2;
+constexpr std::size_t kOutputQueueCapacity = 8;
+// Estimated memory of the graphs held from the start of their generation
+// until their JSON file is written, counting the graph, its frozen copy and
+// its JSON string, so that the peak memory does not grow with the number of
+// graphs.
+constexpr std::size_t kMaxInFlightBytes = std::size_t(1) << 30;
+
+using Reservation = uni_course_cpp::GraphGenerationController::Reservation;
+
+// Each graph travels through the output stages with its reservation, which
+// is given back once the file is written.
+struct FinishedGraph {
+  int index;
+  uni_course_cpp::Graph graph;
+  Reservation reservation;
+};
+
+struct GraphJson {
+  int index;
+  std::string json;
+  Reservation reservation;
+};
+
 void write_to_file(const std::string& string, const std::string& file_name) {
   std::ofstream file(file_name);
   file << string;
@@ -175,35 +206,62 @@ std::string generation_finished_string(int graph_number,
          graph_description;
 }
 
-std::vector<uni_course_cpp::Graph> generate_graphs(
-    uni_course_cpp::GraphGenerator::Params&& params,
-    int graphs_count,
-    int threads_count) {
+void generate_graphs(uni_course_cpp::GraphGenerator::Params&& params,
+                     int graphs_count,
+                     int threads_count) {
   auto generation_controller = uni_course_cpp::GraphGenerationController(
-      threads_count, graphs_count, std::move(params));
+      threads_count, graphs_count, std::move(params),
+      uni_course_cpp::GraphGenerationController::Limits(0,
+                                                        kMaxInFlightBytes));
 
   auto& logger = uni_course_cpp::Logger::get_logger();
 
-  auto graphs = std::vector<uni_course_cpp::Graph>();
-  graphs.reserve(graphs_count);
+  auto finished_graphs =
+      uni_course_cpp::BoundedQueue<FinishedGraph>(kOutputQueueCapacity);
+  auto graph_jsons =
+      uni_course_cpp::BoundedQueue<GraphJson>(kOutputQueueCapacity);
 
-  generation_controller.generate(
-      [&logger](int index) { logger.log(generation_started_string(index)); },
-      [&logger, &graphs](int index, uni_course_cpp::Graph&& graph) {
-        graphs.push_back(graph);
+  auto serializers = std::vector<std::thread>();
+  for (int i = 0; i < kSerializersCount; ++i) {
+    serializers.emplace_back([&logger, &finished_graphs, &graph_jsons]() {
+      while (auto finished_graph = finished_graphs.pop()) {
+        const auto index = finished_graph->index;
+        const auto graph =
+            uni_course_cpp::FrozenGraph(std::move(finished_graph->graph));
 
         const auto graph_description =
             uni_course_cpp::printing::print_graph(graph);
         logger.log(generation_finished_string(index, graph_description));
 
-        const auto graph_json =
-            uni_course_cpp::printing::json::print_graph(graph);
-        write_to_file(graph_json, uni_course_cpp::config::kTempDirectoryPath +
-                                      std::string("graph_") +
-                                      std::to_string(index) + ".json");
+        graph_jsons.push({index,
+                          uni_course_cpp::printing::json::print_graph(graph),
+                          std::move(finished_graph->reservation)});
+      }
+    });
+  }
+  auto writer = std::thread([&graph_jsons]() {
+    while (const auto graph_json = graph_jsons.pop()) {
+      write_to_file(graph_json->json,
+                    uni_course_cpp::config::kTempDirectoryPath +
+                        std::string("graph_") +
+                        std::to_string(graph_json->index) + ".json");
+    }
+  });
+
+  generation_controller.generate(
+      [&logger](int index) { logger.log(generation_started_string(index)); },
+      [&finished_graphs](int index, uni_course_cpp::Graph&& generated_graph,
+                         Reservation&& reservation) {
+        finished_graphs.push(
+            {index, std::move(generated_graph), std::move(reservation)});
       });
 
-  return graphs;
+  finished_graphs.close();
+  for (auto& serializer : serializers) {
+    serializer.join();
+  }
+  graph_jsons.close();
+  writer.join();
 }
 
 int main() {
@@ -215,8 +273,7 @@ int main() {
 
   auto params =
       uni_course_cpp::GraphGenerator::Params(depth, new_vertices_count);
-  const auto graphs =
-      generate_graphs(std::move(params), graphs_count, threads_count);
+  generate_graphs(std::move(params), graphs_count, threads_count);
 
   return 0;
 }
@@ -0,0 +1,33 @@
+#include "random_stream.hpp"
+#include <cstdint>
+#include <random>
+
+namespace {
+std::uint64_t split_mix(std::uint64_t& state) {
+  auto result = (state += 0x9E3779B97F4A7C15ull);
+  result = (result ^ (result >> 30)) * 0xBF58476D1CE4E5B9ull;
+  result = (result ^ (result >> 27)) * 0x94D049BB133111EBull;
+  return result ^ (result >> 31);
+}
+}  // namespace
+
+namespace uni_course_cpp {
+RandomStream::RandomStream(std::uint64_t seed, std::uint64_t stream_id) {
+  // SplitMix64 seeding as recommended for xoshiro; the stream id is mixed in
+  // first so that neighbouring ids yield unrelated states.
+  auto split_mix_state = derive_seed(seed, stream_id);
+  for (auto& word : state_) {
+    word = split_mix(split_mix_state);
+  }
+}
+
+std::uint64_t RandomStream::make_random_seed() {
+  std::random_device device;
+  return (static_cast<std::uint64_t>(device()) << 32) | device();
+}
+
+std::uint64_t RandomStream::derive_seed(std::uint64_t seed, std::uint64_t key) {
+  auto state = seed ^ split_mix(key);
+  return split_mix(state);
+}
+}  // namespace uni_course_cpp
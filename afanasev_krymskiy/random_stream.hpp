@@ -0,0 +1,58 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace uni_course_cpp {
+// Small fast generator (xoshiro256**) whose state is derived from a seed and
+// a stream id. Every job draws from the stream of its own id, so the output
+// depends only on the seed and never on how jobs are spread over threads.
+class RandomStream {
+ public:
+  using result_type = std::uint64_t;
+
+  RandomStream(std::uint64_t seed, std::uint64_t stream_id);
+
+  // Non-deterministic seed for callers that do not need reproducibility.
+  static std::uint64_t make_random_seed();
+
+  // Mixes a key into a seed, e.g. to give every graph of a batch its own
+  // seed.
+  static std::uint64_t derive_seed(std::uint64_t seed, std::uint64_t key);
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return ~result_type(0); }
+
+  result_type operator()() {
+    const auto result = rotate_left(state_[1] * 5, 7) * 9;
+    const auto shifted = state_[1] << 17;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= shifted;
+    state_[3] = rotate_left(state_[3], 45);
+    return result;
+  }
+
+  // Uniform double in [0, 1) built from the top 53 bits.
+  double uniform() { return (operator()() >> 11) * 0x1.0p-53; }
+
+  bool check_probability(double probability) {
+    return uniform() < probability;
+  }
+
+  // Uniform index in [0, size), by Lemire's multiply-shift reduction.
+  std::size_t uniform_index(std::size_t size) {
+    return static_cast<std::size_t>(
+        (static_cast<unsigned __int128>(operator()()) * size) >> 64);
+  }
+
+ private:
+  static result_type rotate_left(result_type value, int shift) {
+    return (value << shift) | (value >> (64 - shift));
+  }
+
+  std::array<result_type, 4> state_ = {};
+};
+}  // namespace uni_course_cpp
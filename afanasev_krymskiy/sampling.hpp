@@ -0,0 +1,73 @@
+#pragma once
+#include <cmath>
+#include <cstddef>
+#include <random>
+#include "random_stream.hpp"
+
+namespace uni_course_cpp {
+namespace sampling {
+// Walking the CDF costs a step per success, so large means are left to the
+// rejection sampler of the standard library.
+constexpr double kMaxInversionMean = 32;
+
+// Number of successes in `trials_count` Bernoulli trials, drawn with a
+// single uniform by walking the binomial CDF.
+template <typename Count>
+Count binomial(RandomStream& stream, Count trials_count, double probability) {
+  if (trials_count <= 0 || !(probability > 0)) {
+    return 0;
+  }
+  if (probability >= 1) {
+    return trials_count;
+  }
+  const auto failure_probability = 1 - probability;
+  if (trials_count * probability > kMaxInversionMean) {
+    return std::binomial_distribution<Count>(trials_count,
+                                             probability)(stream);
+  }
+  auto mass = std::pow(failure_probability, trials_count);
+  const auto odds = probability / failure_probability;
+  auto remainder = stream.uniform() - mass;
+  Count successes_count = 0;
+  while (remainder >= 0 && successes_count < trials_count) {
+    mass *= odds * (trials_count - successes_count) / (successes_count + 1);
+    ++successes_count;
+    remainder -= mass;
+  }
+  return successes_count;
+}
+
+// Calls `callback(index)` for every successful trial among `trials_count`
+// independent trials of the same probability. Successes are reached by
+// geometric skips, so the stream is drawn once per success rather than
+// once per trial.
+template <typename Callback>
+void for_each_success(RandomStream& stream,
+                      std::size_t trials_count,
+                      double probability,
+                      const Callback& callback) {
+  if (!(probability > 0)) {
+    return;
+  }
+  if (probability >= 1) {
+    for (std::size_t index = 0; index < trials_count; ++index) {
+      callback(index);
+    }
+    return;
+  }
+  const auto log_failure_probability = std::log1p(-probability);
+  std::size_t index = 0;
+  while (index < trials_count) {
+    // 1 - uniform() lies in (0, 1], so the logarithm is finite.
+    const auto skip =
+        std::floor(std::log(1 - stream.uniform()) / log_failure_probability);
+    if (skip >= trials_count - index) {
+      return;
+    }
+    index += static_cast<std::size_t>(skip);
+    callback(index);
+    ++index;
+  }
+}
+}  // namespace sampling
+}  // namespace uni_course_cpp
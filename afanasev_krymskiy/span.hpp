@@ -0,0 +1,34 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace uni_course_cpp {
+// Read-only view over a contiguous column, a small stand-in for C++20
+// std::span.
+template <typename T>
+class Span {
+ public:
+  Span() = default;
+  Span(const T* data, std::size_t size) : data_(data), size_(size) {}
+  template <typename Allocator>
+  Span(const std::vector<T, Allocator>& vector)
+      : data_(vector.data()), size_(vector.size()) {}
+
+  const T* data() const { return data_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const T* begin() const { return data_; }
+  const T* end() const { return data_ + size_; }
+
+  const T& operator[](std::size_t index) const {
+    assert(index < size_);
+    return data_[index];
+  }
+
+ private:
+  const T* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+}  // namespace uni_course_cpp
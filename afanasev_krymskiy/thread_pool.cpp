@@ -0,0 +1,138 @@
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <cassert>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace {
+struct WorkerIdentity {
+  const void* pool = nullptr;
+  int index = -1;
+};
+
+thread_local WorkerIdentity current_worker;
+}  // namespace
+
+namespace uni_course_cpp {
+ThreadPool& ThreadPool::get_thread_pool() {
+  static ThreadPool thread_pool(
+      std::max(1u, std::thread::hardware_concurrency()));
+  return thread_pool;
+}
+
+ThreadPool::ThreadPool(int threads_count) : queues_(threads_count) {
+  assert(threads_count > 0);
+  threads_.reserve(threads_count);
+  for (int i = 0; i < threads_count; ++i) {
+    threads_.emplace_back([this, i]() { run_worker(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    const std::lock_guard lock(sleep_mutex_);
+    should_terminate_ = true;
+  }
+  sleep_condition_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::submit(TaskGroup& group, Task&& task) {
+  ++group.pending_tasks_count_;
+  const auto worker_index = get_worker_index();
+  const auto queue_index = worker_index != -1
+                               ? worker_index
+                               : next_queue_index_++ % queues_.size();
+  {
+    auto& queue = queues_[queue_index];
+    const std::lock_guard lock(queue.mutex);
+    queue.tasks.push_back({std::move(task), &group});
+  }
+  {
+    // Sleepers check the count under this mutex, so the wake-up is not lost.
+    const std::lock_guard lock(sleep_mutex_);
+    ++queued_tasks_count_;
+  }
+  sleep_condition_.notify_one();
+}
+
+void ThreadPool::wait(TaskGroup& group) {
+  const auto worker_index = get_worker_index();
+  while (!group.is_done()) {
+    if (try_run_task(worker_index))
+      continue;
+    std::unique_lock lock(sleep_mutex_);
+    sleep_condition_.wait(lock, [this, &group]() {
+      return group.is_done() || queued_tasks_count_ > 0;
+    });
+  }
+}
+
+int ThreadPool::get_worker_index() const {
+  return current_worker.pool == this ? current_worker.index : -1;
+}
+
+bool ThreadPool::try_pop(int queue_index, QueuedTask& queued_task) {
+  auto& queue = queues_[queue_index];
+  const std::lock_guard lock(queue.mutex);
+  if (queue.tasks.empty())
+    return false;
+  queued_task = std::move(queue.tasks.back());
+  queue.tasks.pop_back();
+  return true;
+}
+
+bool ThreadPool::try_steal(int thief_index, QueuedTask& queued_task) {
+  const int queues_count = queues_.size();
+  const auto first_index = thief_index != -1 ? thief_index + 1 : 0;
+  for (int i = 0; i < queues_count; ++i) {
+    const auto victim_index = (first_index + i) % queues_count;
+    if (victim_index == thief_index)
+      continue;
+    auto& queue = queues_[victim_index];
+    const std::lock_guard lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      queued_task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ThreadPool::try_run_task(int worker_index) {
+  auto queued_task = QueuedTask();
+  const auto is_found =
+      (worker_index != -1 && try_pop(worker_index, queued_task)) ||
+      try_steal(worker_index, queued_task);
+  if (!is_found)
+    return false;
+  --queued_tasks_count_;
+
+  queued_task.task();
+  if (--queued_task.group->pending_tasks_count_ == 0) {
+    // Waiters check the group under the mutex, so taking it once before the
+    // notification makes sure none of them misses it.
+    { const std::lock_guard lock(sleep_mutex_); }
+    sleep_condition_.notify_all();
+  }
+  return true;
+}
+
+void ThreadPool::run_worker(int worker_index) {
+  current_worker = {this, worker_index};
+  while (true) {
+    if (try_run_task(worker_index))
+      continue;
+    std::unique_lock lock(sleep_mutex_);
+    sleep_condition_.wait(lock, [this]() {
+      return should_terminate_ || queued_tasks_count_ > 0;
+    });
+    if (should_terminate_)
+      return;
+  }
+}
+}  // namespace uni_course_cpp
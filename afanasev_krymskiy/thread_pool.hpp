@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace uni_course_cpp {
+// Work-stealing pool: every worker owns a deque, runs its newest task first
+// and steals the oldest tasks of the others when its own deque is empty.
+// Idle workers sleep on a condition variable instead of spinning.
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  // The process-wide pool, one worker per hardware thread. Everything that
+  // runs in parallel shares it, so the threads are created once and the
+  // machine is never oversubscribed.
+  static ThreadPool& get_thread_pool();
+
+  // Tasks submitted together and waited for together. A task may submit
+  // more tasks to its own group.
+  class TaskGroup {
+   public:
+    TaskGroup() = default;
+    TaskGroup(const TaskGroup& other) = delete;
+    void operator=(const TaskGroup& other) = delete;
+
+    bool is_done() const { return pending_tasks_count_ == 0; }
+
+   private:
+    friend class ThreadPool;
+
+    std::atomic<int> pending_tasks_count_ = 0;
+  };
+
+  explicit ThreadPool(int threads_count);
+  ThreadPool(const ThreadPool& other) = delete;
+  void operator=(const ThreadPool& other) = delete;
+  ThreadPool(ThreadPool&& other) = delete;
+  void operator=(ThreadPool&& other) = delete;
+  ~ThreadPool();
+
+  int threads_count() const { return threads_.size(); }
+
+  // Workers push onto their own deque, other threads spread their tasks over
+  // all deques.
+  void submit(TaskGroup& group, Task&& task);
+
+  // Runs pending tasks until the group is done, so that waiting inside a
+  // task never holds a worker back.
+  void wait(TaskGroup& group);
+
+ private:
+  struct QueuedTask {
+    Task task;
+    TaskGroup* group = nullptr;
+  };
+
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<QueuedTask> tasks;
+  };
+
+  // Index of the calling thread's queue, or -1 for threads of other pools.
+  int get_worker_index() const;
+  bool try_pop(int queue_index, QueuedTask& queued_task);
+  bool try_steal(int thief_index, QueuedTask& queued_task);
+  bool try_run_task(int worker_index);
+  void run_worker(int worker_index);
+
+  std::vector<WorkerQueue> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<int> queued_tasks_count_ = 0;
+  std::atomic<unsigned> next_queue_index_ = 0;
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_condition_;
+  bool should_terminate_ = false;
+};
+}  // namespace uni_course_cpp
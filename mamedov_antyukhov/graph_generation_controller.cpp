@@ -7,20 +7,20 @@ namespace uni_course_cpp {
 void GraphGenerationController::Worker::start() {
   assert(state_ == State::Idle);
   state_ = State::Working;
-  thread_ =
-      std::thread([&state = state_, &get_job_callback = get_job_callback_]() {
-        while (true) {
-          if (state == State::ShouldTerminate) {
-            state = State::Idle;
-            return;
-          }
-          const auto job_optional = get_job_callback();
-          if (job_optional.has_value()) {
-            const auto& job = job_optional.value();
-            job();
-          }
-        }
-      });
+  thread_ = std::thread([&state = state_,
+                         &get_job_callback = get_job_callback_,
+                         &job_callback = job_callback_]() {
+    while (true) {
+      if (state == State::ShouldTerminate) {
+        state = State::Idle;
+        return;
+      }
+      const auto index_optional = get_job_callback();
+      if (index_optional.has_value()) {
+        job_callback(index_optional.value());
+      }
+    }
+  });
 }
 
 void GraphGenerationController::Worker::stop() {
@@ -43,19 +43,23 @@ GraphGenerationController::GraphGenerationController(
     : threads_count_(threads_count),
       graphs_count_(graphs_count),
       graph_generator_(GraphGenerator(std::move(graph_generator_params))) {
-  const auto get_job_callback = [&jobs = jobs_, &jobs_mutex = jobs_mutex_]()
-      -> std::optional<GraphGenerationController::JobCallback> {
-    const std::lock_guard<std::mutex> jobs_lock(jobs_mutex);
-    if (!jobs.empty()) {
-      auto job = jobs.front();
-      jobs.pop();
-      return job;
+  const auto get_job_callback = [&next_graph_index = next_graph_index_,
+                                 graphs_count]() -> std::optional<int> {
+    // Idle workers keep polling, so the counter is only bumped while jobs
+    // are left and cannot overflow.
+    if (next_graph_index.load() >= graphs_count) {
+      return std::nullopt;
+    }
+    const auto index = next_graph_index++;
+    if (index < graphs_count) {
+      return index;
     }
 
     return std::nullopt;
   };
+  const auto job_callback = [&job = job_](int index) { job(index); };
   for (int i = 0; i < graphs_count_; ++i) {
-    workers_.emplace_back(get_job_callback);
+    workers_.emplace_back(get_job_callback, job_callback);
   }
 }
 
@@ -64,22 +68,21 @@ void GraphGenerationController::generate(
     const GenFinishedCallback& gen_finished_callback) {
   std::atomic<int> graphs_created_num = graphs_count_;
   std::mutex gen_mutex;
-  for (int i = 0; i < graphs_count_; ++i) {
-    jobs_.push([&gen_started_callback, &gen_finished_callback,
-                &graph_generator = graph_generator_, i, &graphs_created_num,
-                &gen_mutex]() {
-      {
-        const std::lock_guard<std::mutex> gen_start_lock(gen_mutex);
-        gen_started_callback(i);
-      }
-      auto graph = graph_generator.generate();
-      {
-        const std::lock_guard<std::mutex> gen_finish_lock(gen_mutex);
-        gen_finished_callback(i, std::move(graph));
-      }
-      --graphs_created_num;
-    });
-  }
+  job_ = [&gen_started_callback, &gen_finished_callback,
+          &graph_generator = graph_generator_, &graphs_created_num,
+          &gen_mutex](int i) {
+    {
+      const std::lock_guard<std::mutex> gen_start_lock(gen_mutex);
+      gen_started_callback(i);
+    }
+    auto graph = graph_generator.generate();
+    {
+      const std::lock_guard<std::mutex> gen_finish_lock(gen_mutex);
+      gen_finished_callback(i, std::move(graph));
+    }
+    --graphs_created_num;
+  };
+  next_graph_index_ = 0;
 
   for (auto& worker : workers_) {
     worker.start();
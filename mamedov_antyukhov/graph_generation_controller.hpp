@@ -1,9 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <functional>
 #include <list>
 #include <optional>
-#include <queue>
 #include <thread>
 #include "graph_generator.hpp"
 
@@ -21,14 +21,16 @@ class GraphGenerationController {
                 const GenFinishedCallback& gen_finished_callback);
 
  private:
-  using JobCallback = std::function<void()>;
+  // A job is just the index of the graph to generate.
+  using JobCallback = std::function<void(int index)>;
 
   class Worker {
    public:
-    using GetJobCallback = std::function<std::optional<JobCallback>()>;
+    using GetJobCallback = std::function<std::optional<int>()>;
 
-    explicit Worker(const GetJobCallback& get_job_callback)
-        : get_job_callback_(get_job_callback) {}
+    Worker(const GetJobCallback& get_job_callback,
+           const JobCallback& job_callback)
+        : get_job_callback_(get_job_callback), job_callback_(job_callback) {}
 
     void start();
     void stop();
@@ -40,14 +42,17 @@ class GraphGenerationController {
 
     std::thread thread_;
     GetJobCallback get_job_callback_;
+    JobCallback job_callback_;
     State state_ = State::Idle;
   };
 
   std::list<Worker> workers_;
-  std::queue<JobCallback> jobs_;
+  // Workers claim graph indices from the counter, so jobs need neither a
+  // queue nor a lock.
+  std::atomic<int> next_graph_index_ = 0;
+  JobCallback job_;
   int threads_count_;
   int graphs_count_;
   GraphGenerator graph_generator_;
-  std::mutex jobs_mutex_;
 };
 }  // namespace uni_course_cpp